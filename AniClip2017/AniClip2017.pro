@@ -11,10 +11,17 @@ greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
 TARGET = AniClip2017
 TEMPLATE = app
 
+# Compile trace and debug logging out of release builds.
+CONFIG(release, debug|release): DEFINES += LOGGER_MIN_LEVEL=2
 
 SOURCES += main.cpp\
         mainwindow.cpp \
     logger.cpp \
+    logring.cpp \
+    logsink.cpp \
+    logfile.cpp \
+    tracer.cpp \
+    perfstats.cpp \
     clipinfoedit.cpp \
     autocompleteredit.cpp \
     clipdatabase.cpp \
@@ -29,10 +36,34 @@ SOURCES += main.cpp\
     editscreen.cpp \
     addscreen.cpp \
     cliptreewidget.cpp \
-    listselectdialog.cpp
+    listselectdialog.cpp \
+    clipsnapshot.cpp \
+    clipparser.cpp \
+    cliploader.cpp \
+    stringpool.cpp \
+    naturalsort.cpp \
+    clipstore.cpp \
+    postingindex.cpp \
+    intervalindex.cpp \
+    clipquery.cpp \
+    cliptreemodel.cpp \
+    rowdiff.cpp \
+    searchthread.cpp \
+    searchcoordinator.cpp \
+    clipjournal.cpp \
+    savetransaction.cpp \
+    backupstore.cpp \
+    modelsnapshot.cpp \
+    savethread.cpp \
+    benchmark.cpp
 
 HEADERS  += mainwindow.h \
     logger.h \
+    logring.h \
+    logsink.h \
+    logfile.h \
+    tracer.h \
+    perfstats.h \
     clipinfoedit.h \
     autocompleteredit.h \
     clipdatabase.h \
@@ -47,7 +78,26 @@ HEADERS  += mainwindow.h \
     editscreen.h \
     addscreen.h \
     cliptreewidget.h \
-    listselectdialog.h
+    listselectdialog.h \
+    clipsnapshot.h \
+    clipparser.h \
+    cliploader.h \
+    stringpool.h \
+    naturalsort.h \
+    clipstore.h \
+    postingindex.h \
+    intervalindex.h \
+    clipquery.h \
+    cliptreemodel.h \
+    rowdiff.h \
+    searchthread.h \
+    searchcoordinator.h \
+    clipjournal.h \
+    savetransaction.h \
+    backupstore.h \
+    modelsnapshot.h \
+    savethread.h \
+    benchmark.h
 
 FORMS    += mainwindow.ui \
     clipinfoedit.ui \
@@ -0,0 +1,611 @@
+#include "backupstore.h"
+#include "savetransaction.h"
+#include "logger.h"
+#include "tracer.h"
+
+#include <QFile>
+#include <QFileInfo>
+#include <QDir>
+#include <QDirIterator>
+#include <QDateTime>
+#include <QSaveFile>
+#include <QTextStream>
+#include <QCryptographicHash>
+#include <QtAlgorithms>
+
+static const qint64 MIN_CHUNK = 4 * 1024;
+static const qint64 MAX_CHUNK = 64 * 1024;
+static const quint32 CHUNK_MASK = 0xFFFC0000; // 14 bits: a boundary every ~16KB of random data
+
+static const char *GENERATION_FORMAT = "yyyyMMdd_HHmmsszzz";
+static const int GENERATION_LENGTH = 18;
+
+// Gear table for the rolling hash. Fixed seed, so chunk boundaries are the
+// same from run to run and across machines.
+static const quint32* gearTable() {
+    static quint32 table[256];
+    static bool init_flag = false;
+
+    if (!init_flag) {
+        quint32 state = 0x9E3779B9;
+        for (int i = 0; i < 256; i++) {
+            state ^= state << 13;
+            state ^= state >> 17;
+            state ^= state << 5;
+            table[i] = state;
+        }
+        init_flag = true;
+    }
+
+    return table;
+}
+
+BackupStore::BackupStore(logger::Logger *nLog, QString root_path) :
+    log(nLog),
+    rootPath(root_path),
+    keepRecent(10),
+    keepDaily(7),
+    keepWeekly(4),
+    fullInterval(10),
+    numNewChunks(0),
+    numNewBytes(0)
+{
+
+}
+
+void BackupStore::setRetention(int nRecent, int nDaily, int nWeekly) {
+    keepRecent = nRecent;
+    keepDaily = nDaily;
+    keepWeekly = nWeekly;
+}
+
+// Number of generations per chain, the full backup that starts it included.
+// 1 makes every backup a full one.
+void BackupStore::setFullInterval(int nGenerations) {
+    fullInterval = qMax(nGenerations, 1);
+}
+
+// Full backup of every file.
+QString BackupStore::backup(QStringList filenames) {
+    logger::TraceSpan span("BackupStore.backup");
+    QString rGeneration;
+
+    numNewChunks = 0;
+    numNewBytes = 0;
+
+    QStringList previous = generations();
+    Manifest last;
+    if (!previous.isEmpty() && readManifest(previous.first(), last) && !last.base.isEmpty()) {
+        Manifest lastBase;
+        if (readManifest(last.base, lastBase)) {
+            last.files += lastBase.files;
+        }
+    }
+
+    Manifest nManifest;
+    if (backupFiles(filenames, last.files, nManifest.files)) {
+        rGeneration = writeGeneration(nManifest);
+    }
+
+    return rGeneration;
+}
+
+// Incremental backup on top of the newest generation's chain: every file but
+// journaled_filename in full, plus segment_filenames, the journal segments
+// written since the newest generation, oldest first. The caller must only
+// use this while every change since that generation is in those segments.
+// Falls back to a full backup when the chain is too long or unusable.
+QString BackupStore::backupIncremental(QStringList filenames, QString journaled_filename, QStringList segment_filenames) {
+    logger::TraceSpan span("BackupStore.backup");
+    QString rGeneration;
+    bool chain_flag = false;
+
+    QStringList previous = generations();
+    Manifest last;
+    Manifest base;
+
+    if (!previous.isEmpty() && readManifest(previous.first(), last) && last.depth + 1 < fullInterval) {
+        if (last.base.isEmpty()) {
+            base = last;
+            base.base = previous.first();
+            chain_flag = true;
+        }
+        else if (readManifest(last.base, base)) {
+            base.base = last.base;
+            chain_flag = true;
+        }
+
+        bool journaled_flag = false;
+        for (int i = 0; i < base.files.count(); i++) {
+            journaled_flag |= base.files.at(i).name == journaled_filename;
+        }
+        chain_flag &= journaled_flag;
+    }
+
+    if (chain_flag) {
+        numNewChunks = 0;
+        numNewBytes = 0;
+
+        Manifest nManifest;
+        nManifest.base = base.base;
+        nManifest.depth = last.depth + 1;
+        if (!last.base.isEmpty()) {
+            nManifest.segments = last.segments;
+        }
+
+        QStringList others = filenames;
+        others.removeAll(journaled_filename);
+        bool backupSuccess_flag = backupFiles(others, last.files + base.files, nManifest.files);
+
+        for (int i = 0; i < segment_filenames.count() && backupSuccess_flag; i++) {
+            QFileInfo info(segment_filenames.at(i));
+            FileEntry nEntry;
+            nEntry.name     = info.fileName();
+            nEntry.size     = info.size();
+            nEntry.modified = info.lastModified().toMSecsSinceEpoch();
+
+            backupSuccess_flag = chunkFile(segment_filenames.at(i), nEntry);
+            nManifest.segments.append(nEntry);
+        }
+
+        if (backupSuccess_flag) {
+            rGeneration = writeGeneration(nManifest);
+        }
+    }
+    else {
+        rGeneration = backup(filenames);
+    }
+
+    return rGeneration;
+}
+
+// Chunks filenames into rFiles, reusing the chunks of an entry in lastFiles
+// with the same name, size and modification time.
+bool BackupStore::backupFiles(QStringList filenames, const QVector<FileEntry> &lastFiles, QVector<FileEntry> &rFiles) {
+    bool backupSuccess_flag = true;
+
+    for (int i = 0; i < filenames.count() && backupSuccess_flag; i++) {
+        QFileInfo info(filenames.at(i));
+
+        if (info.exists()) {
+            FileEntry nEntry;
+            nEntry.name     = filenames.at(i);
+            nEntry.size     = info.size();
+            nEntry.modified = info.lastModified().toMSecsSinceEpoch();
+
+            bool reused_flag = false;
+            for (int j = 0; j < lastFiles.count() && !reused_flag; j++) {
+                const FileEntry &lEntry = lastFiles.at(j);
+                if (lEntry.name == nEntry.name && lEntry.size == nEntry.size && lEntry.modified == nEntry.modified) {
+                    nEntry.chunks = lEntry.chunks;
+                    reused_flag = true;
+                }
+            }
+
+            if (!reused_flag) {
+                backupSuccess_flag = chunkFile(filenames.at(i), nEntry);
+            }
+
+            rFiles.append(nEntry);
+        }
+        else {
+            log->err(QString("Could not find file \"%1\" for backup.").arg(filenames.at(i)));
+        }
+    }
+
+    return backupSuccess_flag;
+}
+
+QString BackupStore::writeGeneration(const Manifest &nManifest) {
+    QString rGeneration;
+    QString generation = QDateTime::currentDateTime().toString(GENERATION_FORMAT);
+    QString nName = generation;
+    for (int i = 1; QFile::exists(manifestPath(nName)); i++) {
+        nName = QString("%1_%2").arg(generation).arg(i);
+    }
+
+    if (writeManifest(nName, nManifest)) {
+        rGeneration = nName;
+        if (nManifest.base.isEmpty()) {
+            log->info(QString("Backup %1: %2 files, %3 new chunks, %4 bytes written.").arg(nName).arg(nManifest.files.count()).arg(numNewChunks).arg(numNewBytes));
+        }
+        else {
+            log->info(QString("Backup %1 on %2: %3 files, %4 journal segments, %5 new chunks, %6 bytes written.")
+                      .arg(nName).arg(nManifest.base).arg(nManifest.files.count()).arg(nManifest.segments.count()).arg(numNewChunks).arg(numNewBytes));
+        }
+    }
+
+    return rGeneration;
+}
+
+// Journal segments of an incremental backup are written as
+// <journal_filename>.1 to .N, for the next start to replay; rNumSegments is
+// set to N.
+bool BackupStore::restore(QString generation, QString marker_filename, QString journal_filename, int &rNumSegments) {
+    bool restoreSuccess_flag = false;
+    Manifest manifest;
+
+    rNumSegments = 0;
+
+    if (readManifest(generation, manifest)) {
+        QVector<FileEntry> files = manifest.files;
+        bool base_flag = true;
+
+        if (!manifest.base.isEmpty()) {
+            Manifest base;
+            base_flag = readManifest(manifest.base, base);
+
+            for (int i = 0; i < base.files.count(); i++) {
+                bool replaced_flag = false;
+                for (int j = 0; j < manifest.files.count() && !replaced_flag; j++) {
+                    replaced_flag = manifest.files.at(j).name == base.files.at(i).name;
+                }
+                if (!replaced_flag) {
+                    files.append(base.files.at(i));
+                }
+            }
+
+            if (!base_flag) {
+                log->err(QString("Base %1 of backup %2 is missing.").arg(manifest.base).arg(generation));
+            }
+        }
+
+        SaveTransaction transaction(log, marker_filename);
+        restoreSuccess_flag = base_flag;
+
+        for (int i = 0; i < files.count() && restoreSuccess_flag; i++) {
+            restoreSuccess_flag = writeChunks(transaction.stage(files.at(i).name, QIODevice::WriteOnly), files.at(i));
+        }
+
+        for (int i = 0; i < manifest.segments.count() && restoreSuccess_flag; i++) {
+            QString segment_filename = QString("%1.%2").arg(journal_filename).arg(i + 1);
+            restoreSuccess_flag = writeChunks(transaction.stage(segment_filename, QIODevice::WriteOnly), manifest.segments.at(i));
+        }
+
+        if (restoreSuccess_flag) {
+            restoreSuccess_flag = transaction.commit();
+        }
+
+        if (restoreSuccess_flag) {
+            rNumSegments = manifest.segments.count();
+            log->info(QString("Restored %1 files and %2 journal segments from backup %3.").arg(files.count()).arg(rNumSegments).arg(generation));
+        }
+        else {
+            log->err(QString("Unable to restore backup %1. Existing files were left unchanged.").arg(generation));
+        }
+    }
+    else {
+        log->err(QString("Backup %1 not found in \"%2\".").arg(generation).arg(rootPath));
+    }
+
+    return restoreSuccess_flag;
+}
+
+bool BackupStore::writeChunks(QIODevice *nDevice, const FileEntry &nEntry) const {
+    bool writeSuccess_flag = nDevice != NULL;
+
+    for (int i = 0; i < nEntry.chunks.count() && writeSuccess_flag; i++) {
+        QByteArray data = readChunk(nEntry.chunks.at(i));
+        writeSuccess_flag = (data.size() == nEntry.chunks.at(i).length) &&
+                            (nDevice->write(data) == data.size());
+    }
+
+    return writeSuccess_flag;
+}
+
+// Newest first.
+QStringList BackupStore::generations() const {
+    QStringList rGenerations;
+    QDir genDir(rootPath + "/generations");
+    QStringList entries = genDir.entryList(QStringList() << "*.gen" << "*.delta", QDir::Files);
+
+    for (int i = 0; i < entries.count(); i++) {
+        QString cEntry = entries.at(i);
+        cEntry.truncate(cEntry.lastIndexOf('.'));
+        rGenerations.append(cEntry);
+    }
+    qSort(rGenerations.begin(), rGenerations.end(), qGreater<QString>());
+
+    return rGenerations;
+}
+
+// Keeps the newest keepRecent generations, plus the newest generation of each
+// of the last keepDaily days and keepWeekly weeks, plus the full backup each
+// kept incremental one is based on. Returns the number removed.
+//
+// Reads no manifests. Objects are only collected when a full backup is
+// removed, since that is when most of them become unreferenced; what removed
+// incremental backups leave behind waits until then.
+int BackupStore::prune() {
+    logger::TraceSpan span("BackupStore.prune");
+    int numRemoved = 0;
+    bool fullRemoved_flag = false;
+    QStringList gens = generations();
+    QVector<bool> keep(gens.count(), false);
+    QVector<bool> incremental(gens.count(), false);
+    QSet<QDate> days;
+    QSet<int> weeks;
+
+    for (int i = 0; i < gens.count(); i++) {
+        QDateTime genTime = QDateTime::fromString(gens.at(i).left(GENERATION_LENGTH), GENERATION_FORMAT);
+        keep[i] = (i < keepRecent) || !genTime.isValid();
+        incremental[i] = isIncremental(gens.at(i));
+
+        if (genTime.isValid()) {
+            QDate genDate = genTime.date();
+            int weekYear = 0;
+            int week = genDate.weekNumber(&weekYear);
+            int weekKey = weekYear * 100 + week;
+
+            if (days.count() < keepDaily && !days.contains(genDate)) {
+                days.insert(genDate);
+                keep[i] = true;
+            }
+            if (weeks.count() < keepWeekly && !weeks.contains(weekKey)) {
+                weeks.insert(weekKey);
+                keep[i] = true;
+            }
+        }
+    }
+
+    // An incremental backup's base is the next older full backup.
+    bool needBase_flag = false;
+    for (int i = 0; i < gens.count(); i++) {
+        if (incremental.at(i)) {
+            needBase_flag |= keep.at(i);
+        }
+        else {
+            keep[i] = keep.at(i) || needBase_flag;
+            needBase_flag = false;
+        }
+    }
+
+    for (int i = 0; i < gens.count(); i++) {
+        if (!keep.at(i) && QFile::remove(manifestPath(gens.at(i)))) {
+            fullRemoved_flag |= !incremental.at(i);
+            numRemoved++;
+        }
+    }
+
+    if (numRemoved > 0) {
+        log->info(QString("Pruned %1 backups.").arg(numRemoved));
+    }
+    if (fullRemoved_flag) {
+        collectGarbage();
+    }
+
+    return numRemoved;
+}
+
+bool BackupStore::chunkFile(QString filename, FileEntry &rEntry) {
+    bool chunkSuccess_flag = false;
+    QFile file(filename);
+
+    if (file.open(QIODevice::ReadOnly)) {
+        chunkSuccess_flag = true;
+
+        QByteArray contents;
+        const char *data = NULL;
+        qint64 dataSize = file.size();
+
+        uchar *mapped = NULL;
+        if (dataSize > 0) {
+            mapped = file.map(0, dataSize);
+        }
+        if (mapped != NULL) {
+            data = reinterpret_cast<const char*>(mapped);
+        }
+        else {
+            contents = file.readAll();
+            data = contents.constData();
+            dataSize = contents.size();
+        }
+
+        const quint32 *gear = gearTable();
+        quint32 rollingHash = 0;
+        qint64 chunkStart = 0;
+
+        for (qint64 i = 0; i < dataSize && chunkSuccess_flag; i++) {
+            rollingHash = (rollingHash << 1) + gear[static_cast<uchar>(data[i])];
+            qint64 chunkLength = i + 1 - chunkStart;
+
+            if ((chunkLength >= MIN_CHUNK && (rollingHash & CHUNK_MASK) == 0) || chunkLength >= MAX_CHUNK) {
+                ChunkRef nRef;
+                chunkSuccess_flag = storeChunk(data + chunkStart, chunkLength, nRef);
+                rEntry.chunks.append(nRef);
+                chunkStart = i + 1;
+                rollingHash = 0;
+            }
+        }
+
+        if (chunkSuccess_flag && chunkStart < dataSize) {
+            ChunkRef nRef;
+            chunkSuccess_flag = storeChunk(data + chunkStart, dataSize - chunkStart, nRef);
+            rEntry.chunks.append(nRef);
+        }
+
+        if (mapped != NULL) {
+            file.unmap(mapped);
+        }
+    }
+    else {
+        log->err(QString("Unable to read \"%1\" for backup. %2").arg(filename).arg(file.errorString()));
+    }
+
+    return chunkSuccess_flag;
+}
+
+bool BackupStore::storeChunk(const char *nData, int nLength, ChunkRef &rRef) {
+    bool storeSuccess_flag = true;
+    QByteArray raw = QByteArray::fromRawData(nData, nLength);
+
+    rRef.hash = QCryptographicHash::hash(raw, QCryptographicHash::Sha256).toHex();
+    rRef.length = nLength;
+
+    QString path = objectPath(rRef.hash);
+    if (!QFile::exists(path)) {
+        QDir().mkpath(QFileInfo(path).absolutePath());
+
+        QSaveFile object(path);
+        QByteArray compressed = qCompress(raw);
+        storeSuccess_flag = object.open(QIODevice::WriteOnly) &&
+                            object.write(compressed) == compressed.size() &&
+                            object.commit();
+
+        if (storeSuccess_flag) {
+            numNewChunks++;
+            numNewBytes += compressed.size();
+        }
+        else {
+            log->err(QString("Unable to write backup object \"%1\". %2").arg(path).arg(object.errorString()));
+        }
+    }
+
+    return storeSuccess_flag;
+}
+
+QByteArray BackupStore::readChunk(const ChunkRef &nRef) const {
+    QByteArray rData;
+    QFile object(objectPath(nRef.hash));
+
+    if (object.open(QIODevice::ReadOnly)) {
+        rData = qUncompress(object.readAll());
+
+        if (QCryptographicHash::hash(rData, QCryptographicHash::Sha256).toHex() != nRef.hash) {
+            log->err(QString("Backup object \"%1\" is corrupt.").arg(object.fileName()));
+            rData.clear();
+        }
+    }
+    else {
+        log->err(QString("Backup object \"%1\" is missing.").arg(object.fileName()));
+    }
+
+    return rData;
+}
+
+bool BackupStore::readManifest(QString generation, Manifest &rManifest) const {
+    bool readSuccess_flag = false;
+    QFile manifest(manifestPath(generation));
+
+    if (manifest.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        readSuccess_flag = true;
+        QTextStream in(&manifest);
+        in.setCodec("UTF-8");
+        QVector<FileEntry> *entries = NULL;
+
+        while (!in.atEnd() && readSuccess_flag) {
+            QStringList split = in.readLine().split('\t');
+
+            if (split.count() == 3 && split.at(0) == "base") {
+                rManifest.base  = split.at(1);
+                rManifest.depth = split.at(2).toInt();
+            }
+            else if (split.count() == 4 && (split.at(0) == "file" || split.at(0) == "segment")) {
+                FileEntry nEntry;
+                nEntry.name     = split.at(1);
+                nEntry.size     = split.at(2).toLongLong();
+                nEntry.modified = split.at(3).toLongLong();
+
+                entries = (split.at(0) == "file") ? &rManifest.files : &rManifest.segments;
+                entries->append(nEntry);
+            }
+            else if (split.count() == 3 && split.at(0) == "chunk" && entries != NULL) {
+                ChunkRef nRef;
+                nRef.hash   = split.at(1).toLatin1();
+                nRef.length = split.at(2).toLongLong();
+                entries->last().chunks.append(nRef);
+            }
+            else if (!split.at(0).startsWith('#')) {
+                log->err(QString("Backup manifest \"%1\" is corrupt.").arg(manifest.fileName()));
+                readSuccess_flag = false;
+            }
+        }
+    }
+
+    return readSuccess_flag;
+}
+
+bool BackupStore::writeManifest(QString generation, const Manifest &nManifest) {
+    QString path = QString("%1/generations/%2.%3").arg(rootPath).arg(generation).arg(nManifest.base.isEmpty() ? "gen" : "delta");
+    QDir().mkpath(QFileInfo(path).absolutePath());
+
+    QSaveFile manifest(path);
+    bool writeSuccess_flag = manifest.open(QIODevice::WriteOnly | QIODevice::Text);
+
+    if (writeSuccess_flag) {
+        QTextStream out(&manifest);
+        out.setCodec("UTF-8");
+
+        out << "#Backup | " << generation << endl;
+        if (!nManifest.base.isEmpty()) {
+            out << "base\t" << nManifest.base << "\t" << nManifest.depth << endl;
+        }
+        for (int i = 0; i < nManifest.files.count() + nManifest.segments.count(); i++) {
+            bool file_flag = i < nManifest.files.count();
+            const FileEntry &cEntry = file_flag ? nManifest.files.at(i) : nManifest.segments.at(i - nManifest.files.count());
+
+            out << (file_flag ? "file\t" : "segment\t") << cEntry.name << "\t" << cEntry.size << "\t" << cEntry.modified << endl;
+            for (int j = 0; j < cEntry.chunks.count(); j++) {
+                out << "chunk\t" << cEntry.chunks.at(j).hash << "\t" << cEntry.chunks.at(j).length << endl;
+            }
+        }
+        out.flush();
+
+        writeSuccess_flag = manifest.commit();
+    }
+
+    if (!writeSuccess_flag) {
+        log->err(QString("Unable to write backup manifest \"%1\". %2").arg(path).arg(manifest.errorString()));
+    }
+
+    return writeSuccess_flag;
+}
+
+QString BackupStore::objectPath(const QByteArray &nHash) const {
+    QString hex = QString::fromLatin1(nHash);
+    return QString("%1/objects/%2/%3").arg(rootPath).arg(hex.left(2)).arg(hex);
+}
+
+// Path of an existing manifest of either kind; the full backup's path if
+// there is none.
+QString BackupStore::manifestPath(QString generation) const {
+    QString path = QString("%1/generations/%2").arg(rootPath).arg(generation);
+    return QFile::exists(path + ".delta") ? path + ".delta" : path + ".gen";
+}
+
+bool BackupStore::isIncremental(QString generation) const {
+    return QFile::exists(QString("%1/generations/%2.delta").arg(rootPath).arg(generation));
+}
+
+void BackupStore::collectGarbage() {
+    logger::TraceSpan span("BackupStore.collectGarbage");
+    QSet<QString> referenced;
+    QStringList gens = generations();
+    bool manifestsRead_flag = true;
+
+    for (int i = 0; i < gens.count() && manifestsRead_flag; i++) {
+        Manifest manifest;
+        manifestsRead_flag = readManifest(gens.at(i), manifest);
+
+        QVector<FileEntry> entries = manifest.files + manifest.segments;
+        for (int j = 0; j < entries.count(); j++) {
+            for (int k = 0; k < entries.at(j).chunks.count(); k++) {
+                referenced.insert(QString::fromLatin1(entries.at(j).chunks.at(k).hash));
+            }
+        }
+    }
+
+    // An unreadable manifest could still reference anything, so nothing is safe to delete.
+    if (manifestsRead_flag) {
+        int numRemoved = 0;
+        QDirIterator objects(rootPath + "/objects", QDir::Files, QDirIterator::Subdirectories);
+        while (objects.hasNext()) {
+            objects.next();
+            if (!referenced.contains(objects.fileName()) && QFile::remove(objects.filePath())) {
+                numRemoved++;
+            }
+        }
+
+        log->info(QString("Removed %1 unreferenced backup objects.").arg(numRemoved));
+    }
+}
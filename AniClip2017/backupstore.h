@@ -0,0 +1,101 @@
+#ifndef BACKUPSTORE_H
+#define BACKUPSTORE_H
+
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <QByteArray>
+#include <QSet>
+
+class QIODevice;
+
+namespace logger {
+class Logger;
+}
+
+// Content addressed backup store.
+//
+//  <root>/objects/<ab>/<sha256>      one compressed chunk per file
+//  <root>/generations/<name>.gen     manifest of a full backup
+//  <root>/generations/<name>.delta   manifest of an incremental backup
+//
+// Files are cut into content defined chunks, so an edit only changes the
+// chunks around it and every other chunk is shared with earlier generations.
+// A file whose size and modification time match the previous generation is
+// not read at all. Generation names are yyyyMMdd_HHmmsszzz and sort by age.
+//
+// An incremental backup does not read the journaled file (the clip file).
+// It keeps the journal segments written since the last full backup instead,
+// and names that full backup as its base. Restoring it writes the base's
+// copy of the file together with those segments, which the next start
+// replays. Every fullInterval generations the chain starts over with a full
+// backup, so an incremental backup costs about the size of the edits.
+class BackupStore
+{
+public:
+    BackupStore(logger::Logger *nLog, QString root_path);
+
+    void setRetention(int nRecent, int nDaily, int nWeekly);
+    void setFullInterval(int nGenerations);
+
+    QString backup(QStringList filenames);
+    QString backupIncremental(QStringList filenames, QString journaled_filename, QStringList segment_filenames);
+    bool restore(QString generation, QString marker_filename, QString journal_filename, int &rNumSegments);
+
+    QStringList generations() const;
+    int prune();
+
+private:
+    struct ChunkRef {
+        QByteArray  hash;
+        qint64      length;
+    };
+
+    struct FileEntry {
+        QString             name;
+        qint64              size;
+        qint64              modified;
+        QVector<ChunkRef>   chunks;
+    };
+
+    // base is empty for a full backup. depth counts the incremental backups
+    // since the base, this one included.
+    struct Manifest {
+        QString             base;
+        int                 depth;
+        QVector<FileEntry>  files;
+        QVector<FileEntry>  segments;
+
+        Manifest() : base(), depth(0), files(), segments() {}
+    };
+
+    bool backupFiles(QStringList filenames, const QVector<FileEntry> &lastFiles, QVector<FileEntry> &rFiles);
+    QString writeGeneration(const Manifest &nManifest);
+
+    bool writeChunks(QIODevice *nDevice, const FileEntry &nEntry) const;
+    bool chunkFile(QString filename, FileEntry &rEntry);
+    bool storeChunk(const char *nData, int nLength, ChunkRef &rRef);
+    QByteArray readChunk(const ChunkRef &nRef) const;
+
+    bool readManifest(QString generation, Manifest &rManifest) const;
+    bool writeManifest(QString generation, const Manifest &nManifest);
+
+    QString objectPath(const QByteArray &nHash) const;
+    QString manifestPath(QString generation) const;
+    bool isIncremental(QString generation) const;
+    void collectGarbage();
+
+    logger::Logger *log;
+
+    QString rootPath;
+
+    int keepRecent;
+    int keepDaily;
+    int keepWeekly;
+    int fullInterval;
+
+    int numNewChunks;
+    qint64 numNewBytes;
+};
+
+#endif // BACKUPSTORE_H
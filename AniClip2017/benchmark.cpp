@@ -0,0 +1,380 @@
+#include "benchmark.h"
+#include "clipparser.h"
+#include "clipdatabase.h"
+#include "stringpool.h"
+#include "naturalsort.h"
+#include "logger.h"
+
+#include <QDir>
+#include <QFile>
+#include <QElapsedTimer>
+#include <QStringList>
+#include <QTextStream>
+#include <QTime>
+
+namespace benchmark {
+
+static QString writeClipFile(int numLines) {
+    QString rFilename = QDir::temp().filePath("aniclip_benchmark_clips.txt");
+    QFile benchFile(rFilename);
+
+    if (benchFile.open(QIODevice::WriteOnly)) {
+        QByteArray chunk;
+        for (int i = 0; i < numLines; i++) {
+            int start = i % 3000;
+            int end = start + 5 + (i % 40);
+            chunk.append(QString("\tBenchShow%1[|]%2[|]%3-%4[|]Summer[|]%5[|]Tag%6|Tag%7|Action[|]\"Source\"[|][|]Note %8\n")
+                         .arg(i % 2000).arg(i % 26)
+                         .arg(QTime(0, 0).addSecs(start).toString("hh:mm:ss"))
+                         .arg(QTime(0, 0).addSecs(end).toString("hh:mm:ss"))
+                         .arg(2000 + i % 20).arg(i % 97).arg(i % 13).arg(i).toUtf8());
+
+            if (chunk.size() > (1 << 20)) {
+                benchFile.write(chunk);
+                chunk.clear();
+            }
+        }
+        benchFile.write(chunk);
+        benchFile.close();
+    }
+    else {
+        rFilename.clear();
+    }
+
+    return rFilename;
+}
+
+// The split based parse ClipDatabase::addNewClip used before ClipLineParser.
+static bool legacyParse(QString clipLine, int &rChecksum) {
+    bool lineValid_flag = false;
+    QString tLine = clipLine.trimmed();
+    QStringList lineSplit = tLine.split("[|]");
+
+    if (lineSplit.count() == 9) {
+        QStringList timeSplit = lineSplit.at(2).split("-");
+        lineValid_flag = (timeSplit.count() == 2);
+
+        if (lineValid_flag) {
+            QTime startTime = QTime::fromString(timeSplit.at(0), QString("hh:mm:ss"));
+            QTime endTime = QTime::fromString(timeSplit.at(1), QString("hh:mm:ss"));
+
+            QStringList validSeasons;
+            validSeasons << "Spring" << "Summer" << "Fall" << "Winter";
+            bool season_flag = validSeasons.contains(lineSplit.at(3), Qt::CaseInsensitive);
+
+            QStringList tagSplit = lineSplit.at(5).split("|");
+
+            rChecksum += lineSplit.at(1).toInt() + lineSplit.at(4).toInt() + startTime.second() + endTime.second();
+            rChecksum += tagSplit.count() + (season_flag ? 1 : 0) + lineSplit.at(0).length() + lineSplit.at(8).length();
+        }
+    }
+
+    return lineValid_flag;
+}
+
+static bool fastParse(FieldView nLine, int &rChecksum) {
+    ClipLineFields fields;
+    bool lineValid_flag = ClipLineParser::parse(nLine, fields);
+
+    if (lineValid_flag) {
+        int numTags = 0;
+        FieldView tagsView = fields.tags;
+        FieldView cTag;
+        while (ClipLineParser::nextTag(tagsView, cTag)) {
+            numTags++;
+        }
+
+        rChecksum += fields.epNum + fields.year + (fields.startMsecs / 1000) % 60 + (fields.endMsecs / 1000) % 60;
+        rChecksum += numTags + 1 + fields.showName.length + fields.note.length;
+    }
+
+    return lineValid_flag;
+}
+
+// The comparator tags were sorted with before collation keys.
+static bool legacyCompareTags(const QString &s1, const QString &s2) {
+
+    // ignore common prefix..
+    int i = 0;
+    while ((i < s1.length()) && (i < s2.length()) && (s1.at(i).toLower() == s2.at(i).toLower())) {
+        ++i;
+    }
+
+    // Look at Next item
+    //++i;
+
+    // something left to compare?
+    if ((i < s1.length()) && (i < s2.length()))
+    {
+       // get relevant/signficant number string for s1
+       int k = i;
+       QString n1 = "";
+       while ((k < s1.length()) && (s1.at(k).isNumber())) {
+           n1 += s1.at(k);
+           ++k;
+       }
+
+       // get relevant/signficant number string for s2
+       k = i;
+       QString n2 = "";
+       while ((k < s2.length()) && (s2.at(k).isNumber())) {
+           n2 += s2.at(k);
+           ++k;
+       }
+
+       // got two numbers to compare?
+       if (!n1.isEmpty() && !n2.isEmpty())
+       {
+           return n1.toInt() < n2.toInt();
+       }
+       else {
+           // not a number has to win over a number.. number could have ended earlier... same prefix..
+          if (!n1.isEmpty()) {
+              return false;
+          }
+          else if (!n2.isEmpty()) {
+              return true;
+          }
+          else {
+            return s1.at(i) < s2.at(i);
+          }
+       }
+    }
+    else {
+       // shortest string wins
+       return s1.length() < s2.length();
+    }
+
+    return false;
+}
+
+void run(logger::Logger *log) {
+    clipParser(log, 1000000);
+    showInsert(log, 20000);
+    tagSort(log, 100000);
+    tagQuery(log, 400000);
+}
+
+void clipParser(logger::Logger *log, int numLines) {
+    QString filename = writeClipFile(numLines);
+
+    if (filename.isEmpty()) {
+        log->err("benchmark.clipParser: Unable to write benchmark file.");
+    }
+    else {
+        QElapsedTimer nTimer;
+        int legacyLines = 0;
+        int legacyChecksum = 0;
+        qint64 legacyMsecs = 0;
+
+        QFile legacyFile(filename);
+        if (legacyFile.open(QIODevice::ReadOnly | QIODevice::Text)) {
+            QTextStream nStream(&legacyFile);
+            nTimer.start();
+            while (!nStream.atEnd()) {
+                if (legacyParse(nStream.readLine(), legacyChecksum)) {
+                    legacyLines++;
+                }
+            }
+            legacyMsecs = nTimer.elapsed();
+            legacyFile.close();
+        }
+
+        int fastLines = 0;
+        int fastChecksum = 0;
+        qint64 fastMsecs = 0;
+
+        QFile fastFile(filename);
+        if (fastFile.open(QIODevice::ReadOnly)) {
+            nTimer.start();
+            uchar *mapped = fastFile.map(0, fastFile.size());
+            if (mapped != NULL) {
+                const char *cPos = reinterpret_cast<const char*>(mapped);
+                const char *cEnd = cPos + fastFile.size();
+                FieldView line;
+                while (ClipLineParser::nextLine(cPos, cEnd, line)) {
+                    if (fastParse(line, fastChecksum)) {
+                        fastLines++;
+                    }
+                }
+                fastFile.unmap(mapped);
+            }
+            fastMsecs = nTimer.elapsed();
+            fastFile.close();
+        }
+
+        QFile::remove(filename);
+
+        double legacyRate = legacyLines * 1000.0 / qMax<qint64>(legacyMsecs, 1);
+        double fastRate = fastLines * 1000.0 / qMax<qint64>(fastMsecs, 1);
+
+        log->info(QString("benchmark.clipParser: split based  %1 lines in %2 ms (%3 lines/s)").arg(legacyLines).arg(legacyMsecs).arg(legacyRate, 0, 'f', 0));
+        log->info(QString("benchmark.clipParser: ClipLineParser %1 lines in %2 ms (%3 lines/s)").arg(fastLines).arg(fastMsecs).arg(fastRate, 0, 'f', 0));
+        log->info(QString("benchmark.clipParser: speedup %1x").arg(fastRate / qMax(legacyRate, 1.0), 0, 'f', 2));
+
+        if (legacyChecksum != fastChecksum) {
+            log->warn(QString("benchmark.clipParser: Parsers disagree (checksum %1 vs %2).").arg(legacyChecksum).arg(fastChecksum));
+        }
+    }
+}
+
+// Clips of a single show added in shuffled order, once through the sorted
+// insert and once through the bulk path. Both must end in the same order.
+void showInsert(logger::Logger *log, int numClips) {
+    StringPool pool;
+    ClipStore store(&pool);
+    store.reserve(numClips);
+
+    int showId = pool.intern("BenchShow");
+    QVector<int> clipIds;
+    clipIds.reserve(numClips);
+
+    for (int i = 0; i < numClips; i++) {
+        Clip nClip;
+        nClip.showId = showId;
+        nClip.epNum = 1 + i % 24;
+        nClip.bounds.startTime = QTime(0, 0).addSecs((i / 24) % 1500);
+        nClip.bounds.endTime = nClip.bounds.startTime.addSecs(5 + i % 7);
+        clipIds.append(store.addClip(nClip));
+    }
+
+    quint32 seed = 12345;
+    for (int i = clipIds.count() - 1; i > 0; i--) {
+        seed = seed * 1103515245 + 12345;
+        int j = (seed >> 8) % (i + 1);
+        qSwap(clipIds[i], clipIds[j]);
+    }
+
+    QElapsedTimer nTimer;
+
+    ShowList sortedShow(log, &store);
+    nTimer.start();
+    for (int i = 0; i < clipIds.count(); i++) {
+        sortedShow.addClip(clipIds.at(i));
+    }
+    qint64 sortedMsecs = nTimer.elapsed();
+
+    ShowList bulkShow(log, &store);
+    nTimer.start();
+    bulkShow.setBulkInsert(true);
+    for (int i = 0; i < clipIds.count(); i++) {
+        bulkShow.addClip(clipIds.at(i));
+    }
+    bulkShow.setBulkInsert(false);
+    qint64 bulkMsecs = nTimer.elapsed();
+
+    log->info(QString("benchmark.showInsert: sorted insert %1 clips in %2 ms").arg(sortedShow.getClipCount()).arg(sortedMsecs));
+    log->info(QString("benchmark.showInsert: bulk insert   %1 clips in %2 ms").arg(bulkShow.getClipCount()).arg(bulkMsecs));
+
+    if (sortedShow.clips != bulkShow.clips) {
+        log->warn("benchmark.showInsert: Sorted and bulk insert disagree on clip order.");
+    }
+}
+
+// Sorts synthetic tags once with the old per comparison parser and once
+// through cached collation keys, including the time to build the keys.
+void tagSort(logger::Logger *log, int numTags) {
+    static const char *prefixes[] = {"Tag", "tag", "Action", "OP", "Ep"};
+
+    QStringList tags;
+    tags.reserve(numTags);
+
+    quint32 seed = 54321;
+    for (int i = 0; i < numTags; i++) {
+        seed = seed * 1103515245 + 12345;
+        tags.append(QString("%1%2").arg(prefixes[(seed >> 4) % 5]).arg(i));
+    }
+
+    QElapsedTimer nTimer;
+
+    QStringList legacyTags = tags;
+    nTimer.start();
+    qSort(legacyTags.begin(), legacyTags.end(), legacyCompareTags);
+    qint64 legacyMsecs = nTimer.elapsed();
+
+    StringPool pool;
+    QVector<int> tagIds = pool.intern(tags);
+
+    nTimer.start();
+    SortKeyLessThan lessThan;
+    lessThan.stringPool = &pool;
+    qSort(tagIds.begin(), tagIds.end(), lessThan);
+    qint64 keyMsecs = nTimer.elapsed();
+
+    log->info(QString("benchmark.tagSort: compareTags  %1 tags in %2 ms").arg(legacyTags.count()).arg(legacyMsecs));
+    log->info(QString("benchmark.tagSort: sort keys    %1 tags in %2 ms").arg(tagIds.count()).arg(keyMsecs));
+    log->info(QString("benchmark.tagSort: speedup %1x").arg(legacyMsecs / qMax(keyMsecs * 1.0, 1.0), 0, 'f', 2));
+}
+
+// AND and OR tag queries through the store's tag index against a scan of
+// every clip's tags.
+void tagQuery(logger::Logger *log, int numClips) {
+    StringPool pool;
+    ClipStore store(&pool);
+    store.reserve(numClips);
+
+    QVector<int> tagIds;
+    for (int i = 0; i < 200; i++) {
+        tagIds.append(pool.intern(QString("Tag%1").arg(i)));
+    }
+    int showId = pool.intern("BenchShow");
+
+    quint32 seed = 999;
+    for (int i = 0; i < numClips; i++) {
+        Clip nClip;
+        nClip.showId = showId;
+        nClip.epNum = i;
+        nClip.bounds.startTime = QTime(0, 0);
+        nClip.bounds.endTime = QTime(0, 0, 5);
+
+        // Low tag numbers are far more common, like real genre tags.
+        for (int t = 0; t < 4; t++) {
+            seed = seed * 1103515245 + 12345;
+            int tag = ((seed >> 8) % 200) * ((seed >> 20) % 200) / 200;
+            if (!nClip.tagIds.contains(tagIds.at(tag))) {
+                nClip.tagIds.append(tagIds.at(tag));
+            }
+        }
+        store.addClip(nClip);
+    }
+
+    QVector<int> keyIds;
+    keyIds << tagIds.at(3) << tagIds.at(40);
+    QVector<int> subIds;
+    subIds << tagIds.at(90) << tagIds.at(120) << tagIds.at(150);
+
+    QElapsedTimer nTimer;
+    const PostingIndex &index = store.getTagIndex();
+
+    nTimer.start();
+    QVector<int> andIds = index.matchAll(keyIds);
+    qint64 andNsecs = nTimer.nsecsElapsed();
+
+    nTimer.start();
+    QVector<int> orIds = index.matchAny(subIds);
+    qint64 orNsecs = nTimer.nsecsElapsed();
+
+    nTimer.start();
+    int scanAnd = 0;
+    int scanOr = 0;
+    for (int i = 0; i < store.count(); i++) {
+        const QVector<int> &cTags = store.at(i).tagIds;
+        if (cTags.contains(keyIds.at(0)) && cTags.contains(keyIds.at(1))) {
+            scanAnd++;
+        }
+        if (cTags.contains(subIds.at(0)) || cTags.contains(subIds.at(1)) || cTags.contains(subIds.at(2))) {
+            scanOr++;
+        }
+    }
+    qint64 scanMsecs = nTimer.elapsed();
+
+    log->info(QString("benchmark.tagQuery: AND of 2 tags, %1 of %2 clips in %3 ms").arg(andIds.count()).arg(numClips).arg(andNsecs / 1000000.0, 0, 'f', 3));
+    log->info(QString("benchmark.tagQuery: OR of 3 tags, %1 of %2 clips in %3 ms").arg(orIds.count()).arg(numClips).arg(orNsecs / 1000000.0, 0, 'f', 3));
+    log->info(QString("benchmark.tagQuery: full scan for both in %1 ms").arg(scanMsecs));
+
+    if (scanAnd != andIds.count() || scanOr != orIds.count()) {
+        log->warn(QString("benchmark.tagQuery: Index and scan disagree (%1/%2 vs %3/%4).").arg(andIds.count()).arg(orIds.count()).arg(scanAnd).arg(scanOr));
+    }
+}
+
+}
@@ -0,0 +1,22 @@
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <QString>
+
+namespace logger {
+class Logger;
+}
+
+// Micro benchmarks for the data layer. Run with "AniClip2017 --benchmark".
+namespace benchmark {
+
+void run(logger::Logger *log);
+
+void clipParser(logger::Logger *log, int numLines);
+void showInsert(logger::Logger *log, int numClips);
+void tagSort(logger::Logger *log, int numTags);
+void tagQuery(logger::Logger *log, int numClips);
+
+}
+
+#endif // BENCHMARK_H
@@ -1,5 +1,16 @@
 #include "clipdatabase.h"
+#include "clipparser.h"
+#include "cliploader.h"
+#include "clipsnapshot.h"
+#include "clipjournal.h"
+#include "savetransaction.h"
+#include "backupstore.h"
+#include "modelsnapshot.h"
+#include "savethread.h"
+#include "stringpool.h"
+#include "naturalsort.h"
 #include "logger.h"
+#include "tracer.h"
 
 #include <QDebug>
 #include <QString>
@@ -10,85 +21,48 @@
 #include <QtAlgorithms>
 
 
-bool compareTags(const QString &s1, const QString &s2) {
+// Orders groups by the natural order of their names.
+struct GroupLessThan {
+    StringPool *stringPool;
 
-    // ignore common prefix..
-    int i = 0;
-    while ((i < s1.length()) && (i < s2.length()) && (s1.at(i).toLower() == s2.at(i).toLower())) {
-        ++i;
+    bool operator()(TagGroup *t1, TagGroup *t2) const {
+        SortKeyLessThan lessThan;
+        lessThan.stringPool = stringPool;
+        return lessThan(t1->getNameId(), t2->getNameId());
     }
-
-    // Look at Next item
-    //++i;
-
-    // something left to compare?
-    if ((i < s1.length()) && (i < s2.length()))
-    {
-       // get relevant/signficant number string for s1
-       int k = i;
-       QString n1 = "";
-       while ((k < s1.length()) && (s1.at(k).isNumber())) {
-           n1 += s1.at(k);
-           ++k;
-       }
-
-       // get relevant/signficant number string for s2
-       k = i;
-       QString n2 = "";
-       while ((k < s2.length()) && (s2.at(k).isNumber())) {
-           n2 += s2.at(k);
-           ++k;
-       }
-
-       // got two numbers to compare?
-       if (!n1.isEmpty() && !n2.isEmpty())
-       {
-           return n1.toInt() < n2.toInt();
-       }
-       else {
-           // not a number has to win over a number.. number could have ended earlier... same prefix..
-          if (!n1.isEmpty()) {
-              return false;
-          }
-          else if (!n2.isEmpty()) {
-              return true;
-          }
-          else {
-            return s1.at(i) < s2.at(i);
-          }
-       }
-    }
-    else {
-       // shortest string wins
-       return s1.length() < s2.length();
-    }
-
-    return false;
-}
-
-bool compareGroups(TagGroup *t1, TagGroup *t2) {
-    QString s1 = t1->getName();
-    QString s2 = t2->getName();
-    return compareTags(s1, s2);
-}
-
-TagGroup::TagGroup(logger::Logger *nLog, QObject *parent) : QObject(parent),
-log(nLog)
+};
+
+TagGroup::TagGroup(logger::Logger *nLog, StringPool *nPool) :
+log(nLog),
+stringPool(nPool),
+groupNameId(-1),
+groupTags(),
+tagIndex(),
+sortedTagIds(),
+sorted_flag(true)
 {
 
 }
 
 void TagGroup::setName(QString nName) {
-    groupName = nName;
+    groupNameId = stringPool->intern(nName);
 }
 
 bool TagGroup::addTag(QString nTag) {
     bool addSuccess_flag = false;
     if (!nTag.isEmpty()) {
-        if (!groupTags.contains(nTag)) {
-            groupTags.append(nTag);
-            addSuccess_flag = true;
-        }
+        addSuccess_flag = addTagId(stringPool->intern(nTag));
+    }
+    return addSuccess_flag;
+}
+
+bool TagGroup::addTagId(int nTagId) {
+    bool addSuccess_flag = false;
+    if (!tagIndex.contains(nTagId)) {
+        tagIndex.insert(nTagId);
+        groupTags.append(nTagId);
+        sorted_flag = false;
+        addSuccess_flag = true;
     }
     return addSuccess_flag;
 }
@@ -96,53 +70,86 @@ bool TagGroup::addTag(QString nTag) {
 bool TagGroup::addTags(QStringList nTags) {
     bool addSuccess_flag = true;
 
-    groupTags.append(nTags);
-    groupTags.removeDuplicates();
-    groupTags.removeAll("");
+    for (int i = 0; i < nTags.count(); i++) {
+        addTag(nTags.at(i));
+    }
 
     return addSuccess_flag;
 }
 
 bool TagGroup::removeTag(QString nTag) {
     bool removeSuccess_flag = false;
-    if (groupTags.removeOne(nTag)) {
+    int tagId = stringPool->find(nTag);
+    if (tagId != -1 && tagIndex.remove(tagId)) {
+        groupTags.removeOne(tagId);
+        sortedTagIds.removeOne(tagId);
         removeSuccess_flag = true;
     }
     return removeSuccess_flag;
 }
 
-bool TagGroup::addGroup(TagGroup oGroup) {
-    QStringList nTags = oGroup.getTags();
+bool TagGroup::containsTag(QString nTag) {
+    int tagId = stringPool->find(nTag);
+    return tagId != -1 && tagIndex.contains(tagId);
+}
+
+int TagGroup::getTagCount() {
+    return groupTags.count();
+}
+
+bool TagGroup::addGroup(const TagGroup &oGroup) {
+    QVector<int> nTags = oGroup.groupTags;
     int numAdded = 0;
     for (int i = 0; i < nTags.count(); i++) {
-        if (addTag(nTags.at(i))) {
+        if (addTagId(nTags.at(i))) {
             numAdded++;
         }
     }
-    log->info(QString("Added %1 new tags to %2 group").arg(numAdded).arg(groupName));
+    log->info("Added %1 new tags to %2 group", numAdded, getName());
 
     return true;
 }
 
-bool TagGroup::sortThis() {
-    qSort(groupTags.begin(), groupTags.end(), compareTags);
-    return true;
+const QVector<int> &TagGroup::sortedTags() {
+    if (!sorted_flag) {
+        SortKeyLessThan lessThan;
+        lessThan.stringPool = stringPool;
+
+        sortedTagIds = groupTags;
+        qSort(sortedTagIds.begin(), sortedTagIds.end(), lessThan);
+        sorted_flag = true;
+    }
+    return sortedTagIds;
 }
 
 QStringList TagGroup::getTags() {
-    return groupTags;
+    return stringPool->strings(sortedTags());
+}
+
+QVector<int> TagGroup::getTagIds() {
+    return sortedTags();
 }
 
 QString TagGroup::getName() {
-    return groupName;
+    return stringPool->string(groupNameId);
 }
 
-TagManager::TagManager(logger::Logger *nLog, QObject *parent) : QObject(parent),
-    log(nLog)
+int TagGroup::getNameId() {
+    return groupNameId;
+}
+
+TagManager::TagManager(logger::Logger *nLog, StringPool *nPool) :
+    log(nLog),
+    stringPool(nPool),
+    groupIndex()
 {
 
 }
 
+TagManager::~TagManager() {
+    qDeleteAll(groups);
+}
+
 bool TagManager::readTagLine(QString line) {
     bool rFlag = true;
     QStringList split = line.split(":");
@@ -162,15 +169,13 @@ bool TagManager::readTagLine(QString line) {
         }
 
         if (!nTags.isEmpty() && !nName.isEmpty()) {
-            TagGroup *nGroup = new TagGroup(log, this);
-            nGroup->setName(nName);
-            groups.append(nGroup);
+            TagGroup *nGroup = getGroup(nName);
             addTags(tagList, nGroup->getName());
-            log->info(QString("Created new TagGroup %1. Added %2 tags.").arg(nGroup->getName()).arg(nGroup->getTags().count()));
+            log->info("Created new TagGroup %1. Added %2 tags.", nGroup->getName(), nGroup->getTagCount());
         }
     }
     else {
-        log->warn(QString("Invalid tag line: \"%1\"").arg(line));
+        log->warn("Invalid tag line: \"%1\"", line);
         rFlag = false;
     }
 
@@ -189,25 +194,33 @@ bool TagManager::addTag(QString tag, QString groupName) {
     return nGroup->addTag(tag);
 }
 
+// Every tag also lands in "General", so intern once and add the ids to both.
 bool TagManager::addTags(QStringList tags, QString groupName) {
+    TagGroup *generalGroup = getGroup("General");
+    TagGroup *nGroup = generalGroup;
 
-    if (groupName.isEmpty()) {
-        groupName = "General";
+    if (!groupName.isEmpty()) {
+        nGroup = getGroup(groupName);
     }
-    else {
-        getGroup("General")->addTags(tags);
+
+    for (int i = 0; i < tags.count(); i++) {
+        if (!tags.at(i).isEmpty()) {
+            int tagId = stringPool->intern(tags.at(i));
+            generalGroup->addTagId(tagId);
+            nGroup->addTagId(tagId);
+        }
     }
 
-    TagGroup *nGroup = getGroup(groupName);
-    return nGroup->addTags(tags);
+    return true;
 }
 
 TagGroup* TagManager::addGroup(QString nGroupName) {
     TagGroup *rGroup = NULL;
     if (!containsGroup(nGroupName)) {
-        TagGroup *nGroup = new TagGroup(log, this);
+        TagGroup *nGroup = new TagGroup(log, stringPool);
         nGroup->setName(nGroupName);
         groups.append(nGroup);
+        groupIndex.insert(nGroup->getNameId(), nGroup);
         rGroup = nGroup;
     }
 
@@ -215,15 +228,7 @@ TagGroup* TagManager::addGroup(QString nGroupName) {
 }
 
 TagGroup* TagManager::getGroup(QString groupName) {
-    TagGroup *rGroup = NULL;
-    bool rFlag = false;
-
-    for (int i = 0; i < groups.count() && !rFlag; i++) {
-        if (groupName == groups.at(i)->getName()) {
-            rGroup = groups.at(i);
-            rFlag = true;
-        }
-    }
+    TagGroup *rGroup = groupIndex.value(stringPool->find(groupName), NULL);
 
     if (rGroup == NULL) {
         rGroup = addGroup(groupName);
@@ -232,176 +237,241 @@ TagGroup* TagManager::getGroup(QString groupName) {
     return rGroup;
 }
 
+// Orders the groups only. Tags within a group are sorted when first read.
 bool TagManager::sortThis() {
-    qSort(groups.begin(), groups.end(), compareGroups);
-
-    for (int i = 0; i < groups.count(); i++) {
-        groups.at(i)->sortThis();
-    }
+    GroupLessThan lessThan;
+    lessThan.stringPool = stringPool;
+    qSort(groups.begin(), groups.end(), lessThan);
 
     return true;
 }
 
 bool TagManager::containsGroup(QString nName) {
-    bool rFlag = false;
-
-    for (int i = 0; i < groups.count() && !rFlag; i++) {
-        if (nName == groups.at(i)->getName()) {
-            rFlag = true;
-        }
-    }
-
-    return rFlag;
+    int nameId = stringPool->find(nName);
+    return nameId != -1 && groupIndex.contains(nameId);
 }
 
-Clip::Clip(logger::Logger *nLog, QObject *parent) : QObject(parent),
-    log(nLog)
+ClipData::ClipData() :
+    showName(),
+    epNum(0),
+    bounds(),
+    season(),
+    year(0),
+    tags(),
+    localSrc(),
+    link(),
+    note()
 {
 
 }
 
-void Clip::setShowName(QString nShowName) {
-    showName = nShowName;
-}
+ClipData ClipData::fromFields(const ClipLineFields &nFields) {
+    ClipData rData;
+
+    rData.showName          = nFields.showName.toString();
+    rData.epNum             = nFields.epNum;
+    rData.bounds.startTime  = msecsToTime(nFields.startMsecs);
+    rData.bounds.endTime    = msecsToTime(nFields.endMsecs);
+    rData.season            = ClipLineParser::seasonName(nFields.season);
+    rData.year              = nFields.year;
+    rData.localSrc          = nFields.source.toString();
+    rData.link              = nFields.link.toString();
+    rData.note              = nFields.note.toString();
+
+    FieldView tagsView = nFields.tags;
+    FieldView cTag;
+    while (ClipLineParser::nextTag(tagsView, cTag)) {
+        rData.tags.append(cTag.toString());
+    }
 
-void Clip::setEpNum(int nEpNum) {
-    epNum = nEpNum;
+    return rData;
 }
 
-void Clip::setTimeBound(TimeBound nTimeBound) {
-    bounds.startTime    = nTimeBound.startTime;
-    bounds.endTime      = nTimeBound.endTime;
+ClipOrder::ClipOrder() :
+    epNum(0),
+    startMsecs(-1),
+    endMsecs(-1)
+{
+
 }
 
-void Clip::writeClipToFile(QTextStream &nStream) {
+ClipOrder::ClipOrder(const Clip &nClip) :
+    epNum(nClip.epNum),
+    startMsecs(timeToMsecs(nClip.bounds.startTime)),
+    endMsecs(timeToMsecs(nClip.bounds.endTime))
+{
 
-    nStream << showName << "[|]" << epNum << "[|]" << bounds.startTime.toString("hh:mm:ss") << "-" << bounds.endTime.toString("hh:mm:ss") << "[|]";
-    nStream << season << "[|]" << year << "[|]" << tags.join("|") << "[|]" << localSrc << "[|]" << link << "[|]" << note << endl;
 }
 
-bool Clip::compareClip(Clip *oClip) {
+bool ClipOrder::operator<(const ClipOrder &oOrder) const {
     bool rFlag = false;
-    if (    showName == oClip->showName &&
-            epNum    == oClip->epNum    &&
-            bounds.startTime == oClip->bounds.startTime &&
-            bounds.endTime   == oClip->bounds.endTime) {
-        rFlag = true;
+
+    if (epNum != oOrder.epNum) {
+        rFlag = epNum < oOrder.epNum;
+    }
+    else if (startMsecs != oOrder.startMsecs) {
+        rFlag = startMsecs < oOrder.startMsecs;
+    }
+    else {
+        rFlag = endMsecs < oOrder.endMsecs;
     }
 
     return rFlag;
 }
 
-ShowList::ShowList(logger::Logger *nLog, QObject *parent) : QObject(parent),
+ShowList::ShowList(logger::Logger *nLog, ClipStore *nStore) :
+    clips(),
     log(nLog),
-    showName()
+    clipStore(nStore),
+    showId(-1),
+    clipIndex(),
+    order(),
+    bulk_flag(false),
+    sorted_flag(true)
 {
 
 }
 
-void ShowList::writeListToFile(QTextStream &nStream) {
+bool ShowList::addClip(int nClipId) {
+    bool rFlag = false;
+
+    if (!clipIndex.contains(nClipId)) {
+        clipIndex.insert(nClipId);
 
-    nStream << "\t#" << showName << endl;
-    for (int i = 0; i < clips.count(); i++) {
-        nStream << "\t";
-        clips.at(i)->writeClipToFile(nStream);
+        if (bulk_flag) {
+            clips.append(nClipId);
+            order.append(ClipOrder(clipStore->at(nClipId)));
+            sorted_flag = false;
+        }
+        else {
+            insertClip(nClipId);
+        }
+        rFlag = true;
     }
 
+    return rFlag;
 }
 
-bool ShowList::addClip(Clip *nClip) {
-    bool found_flag = false;
+bool ShowList::removeClip(int nClipId) {
     bool rFlag = false;
-    for (int i = 0; i < clips.count() && !found_flag; i++) {
-        if (clips.at(i)->compareClip(nClip)) {
-            found_flag = true;
-        }
-    }
 
-    if (!found_flag) {
-        insertClip(nClip);
+    if (clipIndex.remove(nClipId)) {
+        int index = clips.indexOf(nClipId);
+        clips.remove(index);
+        order.remove(index);
         rFlag = true;
     }
 
     return rFlag;
 }
 
+void ShowList::setBulkInsert(bool nBulk) {
+    bulk_flag = nBulk;
+    if (!bulk_flag) {
+        sortClips();
+    }
+}
+
+void ShowList::sortClips() {
+    if (!sorted_flag) {
+        QVector<QPair<ClipOrder, int> > sorted;
+        sorted.reserve(clips.count());
+        for (int i = 0; i < clips.count(); i++) {
+            sorted.append(qMakePair(order.at(i), clips.at(i)));
+        }
+
+        qSort(sorted);
+
+        for (int i = 0; i < sorted.count(); i++) {
+            order[i] = sorted.at(i).first;
+            clips[i] = sorted.at(i).second;
+        }
+
+        sorted_flag = true;
+    }
+}
+
 QString ShowList::getName() {
-    return showName;
+    return clipStore->getStringPool()->string(showId);
+}
+
+int ShowList::getShowId() {
+    return showId;
 }
 
 void ShowList::setName(QString nName) {
-    showName = nName;
+    showId = clipStore->getStringPool()->intern(nName);
+}
+
+void ShowList::setShowId(int nShowId) {
+    showId = nShowId;
 }
 
 int ShowList::getClipCount() {
     return clips.count();
 }
 
-void ShowList::insertClip(Clip *nClip) {
-    bool clipInserted_flag = false;
-    for (int i = 0; i < clips.count() && !clipInserted_flag; i++) {
-        if (clips.at(i)->epNum > nClip->epNum) {
-            clips.insert(i, nClip);
-            clipInserted_flag = true;
-        }
-        else if (clips.at(i)->epNum == nClip->epNum) {
-            int startTimeDif = clips.at(i)->bounds.startTime.secsTo(nClip->bounds.startTime);
-            int endTimeDif = clips.at(i)->bounds.endTime.secsTo(nClip->bounds.endTime);
-            if (startTimeDif < 0) {
-                clips.insert(i, nClip);
-                clipInserted_flag = true;
-            }
-            else if (startTimeDif == 0) {
-                if (endTimeDif < 0) {
-                    clips.insert(i, nClip);
-                    clipInserted_flag = true;
-                }
-            }
-        }
-    }
+void ShowList::insertClip(int nClipId) {
+    ClipOrder nOrder(clipStore->at(nClipId));
+    int index = qUpperBound(order.begin(), order.end(), nOrder) - order.begin();
 
-    if (!clipInserted_flag) {
-        clips.append(nClip);
-    }
+    clips.insert(index, nClipId);
+    order.insert(index, nOrder);
 }
 
-ClipList::ClipList(logger::Logger *nLog, QObject *parent) : QObject(parent),
+ClipList::ClipList(logger::Logger *nLog, ClipStore *nStore) :
     log(nLog),
+    clipStore(nStore),
+    bulk_flag(false),
+    showIndex(),
+    listNameId(-1),
+    shows(),
     isVisible_flag(true)
 {
 
 }
 
-bool ClipList::addClip(Clip* nClip) {
-\
-    ShowList *cShow = NULL;
+ClipList::~ClipList() {
+    qDeleteAll(shows);
+}
 
-    for (int i = 0; i < shows.count(); i++) {
-        if (shows.at(i)->getName() == nClip->showName) {
-            cShow = shows.at(i);
-        }
-    }
+bool ClipList::addClip(int nClipId) {
+
+    int showId = clipStore->at(nClipId).showId;
+    ShowList *cShow = getShowList(showId);
 
     if (cShow == NULL) {
-        cShow = new ShowList(log, this);
-        cShow->setName(nClip->showName);
+        cShow = new ShowList(log, clipStore);
+        cShow->setShowId(showId);
+        cShow->setBulkInsert(bulk_flag);
         shows.append(cShow);
+        showIndex.insert(showId, cShow);
     }
 
-    return cShow->addClip(nClip);
+    return cShow->addClip(nClipId);
 }
 
-void ClipList::writeListToFile(QTextStream &nStream) {
-
-    nStream << "List::" << listName << endl << "{" << endl << endl;
+bool ClipList::removeClip(int nClipId) {
+    bool rFlag = false;
+    ShowList *cShow = getShowList(clipStore->at(nClipId).showId);
 
-    for (int i = 0; i < shows.count(); i++) {
-        shows.at(i)->writeListToFile(nStream);
-        nStream << endl;
+    if (cShow != NULL && cShow->removeClip(nClipId)) {
+        if (cShow->getClipCount() == 0) {
+            shows.removeOne(cShow);
+            showIndex.remove(cShow->getShowId());
+            delete cShow;
+        }
+        rFlag = true;
     }
 
-    nStream << "}" << endl << endl;
+    return rFlag;
+}
 
+void ClipList::setBulkInsert(bool nBulk) {
+    bulk_flag = nBulk;
+    for (int i = 0; i < shows.count(); i++) {
+        shows.at(i)->setBulkInsert(nBulk);
+    }
 }
 
 void ClipList::setVisible(bool isVisible) {
@@ -414,11 +484,11 @@ bool ClipList::isVisible() {
 
 
 QString ClipList::getName() {
-    return listName;
+    return clipStore->getStringPool()->string(listNameId);
 }
 
 void ClipList::setName(QString nName) {
-    listName = nName;
+    listNameId = clipStore->getStringPool()->intern(nName);
 }
 
 int ClipList::getClipCount() {
@@ -431,33 +501,47 @@ int ClipList::getClipCount() {
 }
 
 ShowList* ClipList::getShowList(QString show_name) {
-    ShowList *rShow = NULL;
-    bool rFlag = false;
-
-    for (int i = 0; i < shows.count() && !rFlag; i++) {
-        ShowList *cShow = shows.at(i);
-
-        if (cShow->getName() == show_name) {
-            rFlag = true;
-            rShow = cShow;
-        }
-    }
+    return getShowList(clipStore->getStringPool()->find(show_name));
+}
 
-    return rShow;
+ShowList* ClipList::getShowList(int show_id) {
+    return showIndex.value(show_id, NULL);
 }
 
 ClipDatabase::ClipDatabase(logger::Logger *nLog, QObject *parent) : QObject(parent),
     log(nLog),
     main_list(NULL),
     existingShows(),
-    used_clips(),
+    existingShowIndex(),
     sub_lists(),
+    stringPool(NULL),
+    clipStore(NULL),
     tagManager(NULL),
+    journal(NULL),
+    saveThread(NULL),
     clips_filename(),
     tags_filename(),
-    shows_filename()
+    shows_filename(),
+    snapshot_flag(true),
+    bulkLoad_flag(false),
+    catalogChanged_flag(false),
+    journalCompact_records(1000),
+    backupRecent(10),
+    backupDaily(7),
+    backupWeekly(4),
+    backupFullEvery(10)
 {
-    tagManager = new TagManager(nLog, this);
+    stringPool = new StringPool();
+    clipStore = new ClipStore(stringPool);
+    tagManager = new TagManager(nLog, stringPool);
+    journal = new ClipJournal(nLog);
+
+    saveThread = new SaveThread(nLog, this);
+    connect(saveThread, SIGNAL(saveStarted()), this, SIGNAL(saveStarted()));
+    connect(saveThread, SIGNAL(saveProgress(int,QString)), this, SIGNAL(saveProgress(int,QString)));
+    connect(saveThread, SIGNAL(saveFinished(bool,int)), this, SLOT(onSaveFinished(bool,int)));
+    connect(saveThread, SIGNAL(saveFinished(bool,int)), this, SIGNAL(saveFinished(bool)));
+    saveThread->start();
     tags_filename = "activeTagList.txt";
     shows_filename = "activeShowList.txt";
     clips_filename = "activeClipDB.txt";
@@ -465,7 +549,21 @@ ClipDatabase::ClipDatabase(logger::Logger *nLog, QObject *parent) : QObject(pare
     initMainList();
 }
 
+ClipDatabase::~ClipDatabase() {
+    saveThread->stop();
+    saveThread->wait();
+    journal->dropSegments(saveThread->getCommittedSegment());
+
+    delete journal;
+    qDeleteAll(sub_lists);
+    delete main_list;
+    delete tagManager;
+    delete clipStore;
+    delete stringPool;
+}
+
 bool ClipDatabase::init(QString config_filename) {
+    logger::TraceSpan span("ClipDatabase.init");
     bool initSuccess_flag = true;
 
     if (log != NULL) {
@@ -478,6 +576,10 @@ bool ClipDatabase::init(QString config_filename) {
             initSuccess_flag = false;
         }
 
+        if (!SaveTransaction::recover(log, clips_filename + ".commit", QStringList() << clips_filename << shows_filename << tags_filename)) {
+            log->err("ClipDatabase.init: Failed to recover interrupted save.");
+        }
+
         if (loadTagList(tags_filename)) {
             log->info(QString("ClipDatabase.init: Loaded Tag file \"%1\"").arg(tags_filename));
         }
@@ -492,12 +594,37 @@ bool ClipDatabase::init(QString config_filename) {
             log->warn(QString("ClipDatabase.init: Failed to load Show File \"%1\".").arg(shows_filename));
         }
 
-        if (loadClips(clips_filename)) {
+        // Shows are sorted once after the load and journal replay instead of
+        // on every insert.
+        setBulkLoad(true);
+
+        if (snapshot_flag && loadSnapshot(clips_filename)) {
+            log->info(QString("ClipDatabase.init: Loaded Clip Snapshot for \"%1\"").arg(clips_filename));
+        }
+        else if (loadClips(clips_filename)) {
             log->info(QString("ClipDatabase.init: Loaded Clip File \"%1\"").arg(clips_filename));
         }
         else {
             log->warn(QString("ClipDatabase.init: Failed to load Clip File \"%1\"").arg(clips_filename));
         }
+
+        if (!journal->replay(this, clips_filename)) {
+            log->warn(QString("ClipDatabase.init: Failed to replay journal for \"%1\"").arg(clips_filename));
+        }
+
+        setBulkLoad(false);
+
+        int numOverlapping = clipStore->getIntervalIndex().countOverlapping();
+        if (numOverlapping > 0) {
+            log->warn(QString("ClipDatabase.init: %1 clips overlap another clip in the same episode.").arg(numOverlapping));
+        }
+
+        // Everything loaded so far is already on disk.
+        catalogChanged_flag = false;
+
+        if (!journal->open(clips_filename)) {
+            log->warn("ClipDatabase.init: Journal unavailable. Every save will rewrite the full files.");
+        }
     }
     else {
         qDebug () << "ERROR - ClipDatabase.init :: Logger not valid.";
@@ -533,6 +660,24 @@ bool ClipDatabase::readConfig(QString config_filename) {
                     else if (id == "shows_filename") {
                         shows_filename = input;
                     }
+                    else if (id == "clip_snapshot") {
+                        snapshot_flag = (input != "false" && input != "0");
+                    }
+                    else if (id == "journal_compact") {
+                        journalCompact_records = input.toInt();
+                    }
+                    else if (id == "backup_recent") {
+                        backupRecent = input.toInt();
+                    }
+                    else if (id == "backup_daily") {
+                        backupDaily = input.toInt();
+                    }
+                    else if (id == "backup_weekly") {
+                        backupWeekly = input.toInt();
+                    }
+                    else if (id == "backup_full_every") {
+                        backupFullEvery = input.toInt();
+                    }
 
                 }
             }
@@ -563,188 +708,79 @@ void ClipDatabase::selfTest() {
     // Add new show
 }
 
+// Changes are already in the journal, so a save only has to fold them into the
+// full files once enough of them have piled up.
+// The journal only holds clip changes. Shows and tags loaded from a file are
+// not journaled, so they force a full save.
 void ClipDatabase::save() {
 
-    saveClips();
-    saveShows();
-    saveTags();
-
-    writeBackup();
-}
-
-void ClipDatabase::saveClips() {
-    log->info(QString("Saving ClipDatabase to file %1.").arg(clips_filename));
-    QFile clipFile(clips_filename);
-    if (clipFile.open(QIODevice::WriteOnly | QIODevice::Text)) {
-        QTextStream out(&clipFile);
-
-        out << "#ClipList | " << QDateTime::currentDateTime().toString("dd MMM YYYY mm:ss") << endl;
-
-        main_list->writeListToFile(out);
-
-        for (int i =0 ;i < sub_lists.count(); i++) {
-            sub_lists.at(i)->writeListToFile(out);
-        }
-
-        clipFile.close();
+    if (catalogChanged_flag || !journal->isOpen() || journal->getRecordCount() >= journalCompact_records) {
+        compact();
     }
 }
 
-void ClipDatabase::saveShows() {
-    log->info(QString("Saving ShowList to file %1.").arg(shows_filename));
-    QFile showFile(shows_filename);
-    if (showFile.open(QIODevice::WriteOnly | QIODevice::Text)) {
-        QTextStream out(&showFile);
+// Hands a snapshot of the model to the writer thread. The journal is rotated
+// at the same moment, so the segment it closes holds exactly the changes the
+// snapshot covers and is dropped once that save is committed.
+void ClipDatabase::compact() {
+    logger::TraceSpan span("ClipDatabase.compact");
+    ModelSnapshot *nSnapshot = new ModelSnapshot(this);
+    nSnapshot->journalSegment = journal->rotate();
+    catalogChanged_flag = false;
 
-        out << "#ShowList | " << QDateTime::currentDateTime().toString("dd MMM YYYY mm:ss") << endl;
-        for (int i = 0; i < existingShows.count(); i++) {
-            out << existingShows.at(i) << endl;
-        }
-        showFile.close();
-    }
+    saveThread->enqueue(nSnapshot);
 }
 
-void ClipDatabase::saveTags() {
-    log->info(QString("Saving TagList to file %1.").arg(tags_filename));
-    QFile tagsFile(tags_filename);
-    if (tagsFile.open(QIODevice::WriteOnly | QIODevice::Text)) {
-        QTextStream out(&tagsFile);
-
-        out << "#TagList | " << QDateTime::currentDateTime().toString("dd MMM YYYY mm:ss") << endl << endl;
-
-        for (int i = 0; i < tagManager->groups.count(); i++) {
-            TagGroup* cGroup = tagManager->groups.at(i);
-            out << "name=" <<cGroup->getName() << ":tags=";
-            QStringList tags = cGroup->getTags();
-            out << tags.at(0);
-            for (int j = 1; j < tags.count(); j++) {
-                out <<"|" << tags.at(j);
-            }
-            out << endl;
-
-        }
-
-        tagsFile.close();
-    }
+void ClipDatabase::waitForSave() {
+    saveThread->waitForIdle();
+    journal->dropSegments(saveThread->getCommittedSegment());
 }
 
-void ClipDatabase::writeBackup() {
-    QDir cDir;
-    QString tBackup = QString("/backup");
-    QString nBackup = QString("/backup_%1").arg(QDateTime::currentDateTime().toString("ddMMyy_mmss"));
-    cDir.setPath(QDir::currentPath() + tBackup);
-
-    if (!cDir.exists()) {
-        if (!cDir.mkdir(".")) {
-            log->err(QString("Unable to create backup folder \"%1\"").arg(tBackup));
-        }
-    }
-
-    cDir.setPath(QDir::currentPath() + tBackup + nBackup);
-    if (!cDir.mkdir(".")) {
-        log->err(QString("Unable to create backup folder \"%1\"").arg(nBackup));
-    }
+bool ClipDatabase::isSaving() {
+    return saveThread->isBusy();
+}
 
-    QFile clipFile(clips_filename);
-    if (clipFile.exists()) {
-        QString bFile = QString(QDir::currentPath() + tBackup + nBackup + "/" + clips_filename);
-        log->info(QString("Backup %1").arg(bFile));
-        if (!clipFile.copy(bFile)) {
-            log->err(QString("Unable to backup ClipDB %1").arg(bFile));
-        }
-    }
-    else {
-        log->err(QString("Could not find file \"%1\" for backup.").arg(clips_filename));
+void ClipDatabase::onSaveFinished(bool nSuccess, int nSegment) {
+    if (nSuccess && nSegment != -1) {
+        journal->dropSegments(nSegment);
     }
+}
 
-    QFile tagsFile(tags_filename);
-    if (tagsFile.exists()) {
-        QString bFile = QString(QDir::currentPath() + tBackup + nBackup + "/" + tags_filename);
-        if (!tagsFile.copy(bFile)) {
-            log->err(QString("Unable to backup TagList %1").arg(bFile));
+// Replaces the live files with a backup generation. Changes made since the
+// last full save are discarded along with the journal. An incremental
+// generation brings its own journal segments.
+bool ClipDatabase::restoreBackup(QString generation) {
+    BackupStore store(log, QDir::currentPath() + "/backup");
+    int numSegments = 0;
+    bool restoreSuccess_flag = store.restore(generation, clips_filename + ".commit", ClipJournal::journalFilename(clips_filename), numSegments);
+
+    // Segments 1 to numSegments came with the backup and are replayed on the
+    // next start; anything else belongs to the state that was replaced.
+    if (restoreSuccess_flag) {
+        QVector<int> segments = ClipJournal::segments(clips_filename);
+        for (int i = 0; i < segments.count(); i++) {
+            if (segments.at(i) > numSegments) {
+                QFile::remove(ClipJournal::segmentFilename(clips_filename, segments.at(i)));
+            }
         }
-    }
-    else {
-        log->err(QString("Could not find file \"%1\" for backup.").arg(tags_filename));
+        QFile::remove(ClipJournal::journalFilename(clips_filename));
     }
 
-    QFile showsFile(shows_filename);
-    if (showsFile.exists()) {
-        QString bFile =QString(QDir::currentPath() + tBackup + nBackup + "/" + shows_filename);
-        if (!showsFile.copy(bFile)) {
-            log->err(QString("Unable to backup ShowList %1").arg(bFile));
-        }
-    }
-    else {
-        log->err(QString("Could not find file \"%1\" for backup.").arg(shows_filename));
-    }
+    return restoreSuccess_flag;
+}
 
+QStringList ClipDatabase::getBackups() {
+    BackupStore store(log, QDir::currentPath() + "/backup");
+    return store.generations();
 }
 
 bool ClipDatabase::loadClips(QString clipList_filename) {
+    logger::TraceSpan span("ClipDatabase.loadClips");
     bool importSuccess_flag = true;
 
     if (!clipList_filename.isEmpty()) {
-        QFile clipsFile(clipList_filename);
-        if (clipsFile.open(QIODevice::ReadOnly | QIODevice::Text)) {
-            QTextStream nStream(&clipsFile);
-
-            int cLineNum = 0;
-            bool withinList_flag = false;
-            QString cListName = "";
-            int numAddedtoList = 0;
-
-
-            while(!nStream.atEnd()) {
-                QString line = nStream.readLine();
-                cLineNum++;
-
-                if (!line.startsWith("#") && !line.isEmpty()) {
-                    bool lineParsed_flag = false;
-                    if (!withinList_flag) {
-                        if (line.startsWith("List::")) {
-                            cListName = line.right(line.length() - 6);
-                            numAddedtoList = 0;
-                            withinList_flag = true;
-                            lineParsed_flag = true;
-                        }
-                    }
-                    else {
-
-                        if (line.startsWith("List::")) {
-                            log->err(QString("Already within list %1. Invalid entry \"%2\"").arg(cListName).arg(line));
-                            lineParsed_flag = true;
-                        }
-
-                        if (line.startsWith("}")) {
-                            log->info(QString("Loaded %1 clips to list %2").arg(numAddedtoList).arg(cListName));
-                            cListName = "";
-                            withinList_flag = false;
-                            lineParsed_flag = true;
-                        }
-
-                        if (line.startsWith("{")) {
-                            lineParsed_flag = true;
-                        }
-                    }
-
-                    if (!lineParsed_flag) {
-                        QVector<QString> nLists;
-                        nLists.append(cListName);
-                        if (addNewClip(line, nLists) != NULL) {
-                            numAddedtoList++;
-                        }
-                    }
-
-                }
-            }
-
-            log->info(QString("Added %1 new Clips.").arg(main_list->getClipCount()));
-        }
-        else {
-            log->warn(QString("Unable to open file \"%1\".").arg(clipList_filename));
-            importSuccess_flag = false;
-        }
+        ClipFileLoader loader(log, this);
+        importSuccess_flag = loader.load(clipList_filename);
     }
     else {
         log->warn(QString("ClipDatabase.loadClips: Filename is empty"));
@@ -754,7 +790,14 @@ bool ClipDatabase::loadClips(QString clipList_filename) {
     return importSuccess_flag;
 }
 
+bool ClipDatabase::loadSnapshot(QString clipList_filename) {
+    logger::TraceSpan span("ClipDatabase.loadSnapshot");
+    ClipSnapshot snapshot(log);
+    return snapshot.load(this, clipList_filename);
+}
+
 bool ClipDatabase::loadShowList(QString showList_filename) {
+    logger::TraceSpan span("ClipDatabase.loadShowList");
     bool importSuccess_flag = false;
 
     if (showList_filename.endsWith(".xml")) {
@@ -764,7 +807,8 @@ bool ClipDatabase::loadShowList(QString showList_filename) {
         QFile nFile(showList_filename);
         if (nFile.open(QIODevice::ReadOnly | QIODevice::Text)) {
             importSuccess_flag = true;
-            QTextStream nStream(&nFile);
+            QString text = ClipLineParser::decodeText(nFile.readAll());
+            QTextStream nStream(&text, QIODevice::ReadOnly);
 
             while (!nStream.atEnd()) {
 
@@ -775,12 +819,11 @@ bool ClipDatabase::loadShowList(QString showList_filename) {
                     int endBound = line.indexOf("]]></series_title");
 
                     QString title = line.mid(startBound + boundLength, endBound - (startBound + boundLength));
-                    existingShows.append(title);
+                    addExistingShow(title);
                 }
             }
         }
 
-        existingShows.removeDuplicates();
         int diff = existingShows.count() - startCount;
         log->info(QString("Added %1 new shows.").arg(diff));
     }
@@ -792,18 +835,18 @@ bool ClipDatabase::loadShowList(QString showList_filename) {
         if (showFile.open(QIODevice::ReadOnly | QIODevice::Text)) {
             importSuccess_flag = true;
 
-            QTextStream tStream(&showFile);
+            QString text = ClipLineParser::decodeText(showFile.readAll());
+            QTextStream tStream(&text, QIODevice::ReadOnly);
 
             while(!tStream.atEnd()) {
                 QString line = tStream.readLine();
 
                 if (!line.isEmpty() && !line.startsWith('#')) {
-                    existingShows.append(line.trimmed());
+                    addExistingShow(line.trimmed());
                 }
             }
         }
 
-        existingShows.removeDuplicates();
         int diff = existingShows.count() - startCount;
         log->info(QString("Added %1 new shows.").arg(diff));
     }
@@ -816,6 +859,7 @@ bool ClipDatabase::loadShowList(QString showList_filename) {
 }
 
 bool ClipDatabase::loadTagList(QString tagList_filename) {
+    logger::TraceSpan span("ClipDatabase.loadTagList");
     bool importSuccess_flag = true;
 
     if (tagManager != NULL) {
@@ -824,7 +868,8 @@ bool ClipDatabase::loadTagList(QString tagList_filename) {
             if (tagFile.open(QIODevice::ReadOnly | QIODevice::Text)) {
                 log->info(QString("Opened %1 for tag import.").arg(tagList_filename));
 
-                QTextStream tStream(&tagFile);
+                QString text = ClipLineParser::decodeText(tagFile.readAll());
+                QTextStream tStream(&text, QIODevice::ReadOnly);
 
                 while(!tStream.atEnd()) {
                     QString line = tStream.readLine();
@@ -845,6 +890,7 @@ bool ClipDatabase::loadTagList(QString tagList_filename) {
             importSuccess_flag = false;
         }
 
+        catalogChanged_flag = true;
         log->info("ClipDatabase.loadTagList:: Sorting results.");
         tagManager->sortThis();
     }
@@ -858,197 +904,276 @@ bool ClipDatabase::loadTagList(QString tagList_filename) {
     return importSuccess_flag;
 }
 
-Clip* ClipDatabase::addNewClip(QString showName, int epNum, TimeBound time, QVector<QString> nLists) {
+int ClipDatabase::addNewClip(QString showName, int epNum, TimeBound time, QVector<QString> nLists) {
 
     int numListsAdded = 0;
-    int numClipsAdded = 0;
-    bool clipAdded_flag = true;
 
-    Clip* rClip = clipExists(showName, epNum, time);
+    int showId = stringPool->intern(showName);
+    int rClipId = clipStore->findClip(ClipKey(showId, epNum, time));
 
-    if (rClip == NULL) {
-        clipAdded_flag = false;
-        rClip = new Clip(log, this);
+    if (rClipId == -1) {
+        Clip nClip;
+        nClip.showId = showId;
+        nClip.epNum = epNum;
+        nClip.bounds = time;
 
-        rClip->setShowName(showName);
-        rClip->setEpNum(epNum);
-        rClip->setTimeBound(time);
+        rClipId = clipStore->addClip(nClip);
 
-        if (!existingShows.contains(showName)) {
-            existingShows.append(showName);
-        }
+        addExistingShow(showName);
 
-        if (main_list->addClip(rClip)) {
+        main_list->addClip(rClipId);
+    }
+
+    QVector<ClipList*> remainingLists = sub_lists;
 
-            clipAdded_flag = true;
-            //Add to composite list of clips
-            used_clips.append(rClip);
+    QMutableVectorIterator<ClipList*> list(remainingLists);
 
+    nLists.removeAll(main_list->getName());
+
+    while(list.hasNext()) {
+        list.next();
+        QMutableVectorIterator<QString> tLists(nLists);
+        while (tLists.hasNext()) {
+            QString tListName = tLists.next();
+            if (tListName == list.value()->getName()) {
+                if (list.value()->addClip(rClipId)) {
+                    numListsAdded++;
+                }
+                tLists.remove();
+            }
         }
-        else {
-            log->warn("Clip already exists.");
 
-            delete rClip;
-            rClip = NULL;
+    }
 
+    if (!nLists.empty()) {
+        for (int i = 0; i < nLists.count(); i++) {
+            if (!nLists.at(i).isEmpty()) {
+                ClipList* nList = new ClipList(log, clipStore);
+                nList->setName(nLists.at(i));
+                nList->setBulkInsert(bulkLoad_flag);
+                sub_lists.append(nList);
+
+                QString test = QString("Created new list \"%1\".").arg(nList->getName());
+                log->info(test);
+                nList->addClip(rClipId);
+                numListsAdded++;
+            }
         }
     }
 
-    if (clipAdded_flag) {
+    //log->info(QString("Added Clip to %1 additional lists.").arg(numListsAdded));
 
-        QVector<ClipList*> remainingLists = sub_lists;
+    return rClipId;
+}
 
-        QMutableVectorIterator<ClipList*> list(remainingLists);
+int ClipDatabase::addNewClip(QString clipLine, QVector<QString> nLists) {
 
-        nLists.removeAll(main_list->getName());
+    int rClipId = -1;
+    QByteArray utf8Line = clipLine.toUtf8();
+    ClipLineFields fields;
 
-        while(list.hasNext()) {
-            list.next();
-            QMutableVectorIterator<QString> tLists(nLists);
-            while (tLists.hasNext()) {
-                QString tListName = tLists.next();
-                if (tListName == list.value()->getName()) {
-                    if (list.value()->addClip(rClip)) {
-                        numListsAdded++;
-                    }
-                    tLists.remove();
+    if (ClipLineParser::parse(FieldView(utf8Line.constData(), utf8Line.size()), fields)) {
+        rClipId = addNewClip(ClipData::fromFields(fields), nLists);
+    }
+
+    return rClipId;
+}
+
+int ClipDatabase::addNewClip(const ClipData &nData, QVector<QString> nLists) {
+
+    int rClipId = addNewClip(nData.showName, nData.epNum, nData.bounds, nLists);
+
+    if (rClipId != -1) {
+        // A copy, since the setters below may detach the store's clips.
+        const Clip rClip = clipStore->at(rClipId);
+
+        clipStore->setSeason(rClipId, stringPool->intern(nData.season));
+        clipStore->setYear(rClipId, nData.year);
+
+        QVector<int> nTagIds = rClip.tagIds;
+        for (int i = 0; i < nData.tags.count(); i++) {
+            if (!nData.tags.at(i).isEmpty()) {
+                int tagId = stringPool->intern(nData.tags.at(i));
+                if (!nTagIds.contains(tagId)) {
+                    nTagIds.append(tagId);
                 }
             }
+        }
+        clipStore->setTags(rClipId, nTagIds);
+
+        tagManager->addTags(nData.tags);
 
+        if (!rClip.localSrc.isEmpty() && nData.localSrc != rClip.localSrc) {
+            log->warn("New Source does not match existing source. Curr=%1 New=%2", rClip.localSrc, nData.localSrc);
+        }
+        else {
+            clipStore->setSource(rClipId, nData.localSrc);
+        }
+        if (!rClip.link.isEmpty() && nData.link != rClip.link) {
+            log->warn("New link does not match existing link. Curr=%1 New=%2", rClip.link, nData.link);
+        }
+        else {
+            clipStore->setLink(rClipId, nData.link);
+        }
+        if (!rClip.note.isEmpty() && nData.note != rClip.note) {
+            log->warn("New Note does not match existing note. Curr=%1 New=%2", rClip.note, nData.note);
+        }
+        else {
+            clipStore->setNote(rClipId, nData.note);
         }
 
-        if (!nLists.empty()) {
-            for (int i = 0; i < nLists.count(); i++) {
-                if (!nLists.at(i).isEmpty()) {
-                    ClipList* nList = new ClipList(log, this);
-                    nList->setName(nLists.at(i));
-                    sub_lists.append(nList);
+        journal->append(JOURNAL_ADD, clipStore->clipLine(rClipId), nLists);
+    }
 
-                    QString test = QString("Created new list \"%1\".").arg(nList->getName());
-                    log->info(test);
-                    nList->addClip(rClip);
-                    numListsAdded++;
+    return rClipId;
+}
+
+void  ClipDatabase::addExistingClip(int /*nClipId*/, QVector<ClipList*> /*nLists*/) {
+
+}
+
+bool ClipDatabase::editClip(int nClipId, const ClipData &nData) {
+    bool rFlag = false;
+
+    if (clipStore->contains(nClipId)) {
+        clipStore->setSeason(nClipId, stringPool->intern(nData.season));
+        clipStore->setYear(nClipId, nData.year);
+
+        QVector<int> nTagIds;
+        for (int i = 0; i < nData.tags.count(); i++) {
+            if (!nData.tags.at(i).isEmpty()) {
+                int tagId = stringPool->intern(nData.tags.at(i));
+                if (!nTagIds.contains(tagId)) {
+                    nTagIds.append(tagId);
                 }
             }
         }
+        clipStore->setTags(nClipId, nTagIds);
+
+        clipStore->setSource(nClipId, nData.localSrc);
+        clipStore->setLink(nClipId, nData.link);
+        clipStore->setNote(nClipId, nData.note);
 
-        //log->info(QString("Added Clip to %1 additional lists.").arg(numListsAdded));
+        tagManager->addTags(nData.tags);
+
+        journal->append(JOURNAL_EDIT, clipStore->clipLine(nClipId));
+        rFlag = true;
     }
 
-    return rClip;
+    return rFlag;
 }
 
-Clip* ClipDatabase::addNewClip(QString clipLine, QVector<QString> nLists) {
+bool ClipDatabase::removeClip(int nClipId) {
+    bool rFlag = false;
 
-    Clip *rClip = NULL;
-    QString tLine = clipLine.trimmed();
+    if (clipStore->contains(nClipId)) {
+        QString cLine = clipStore->clipLine(nClipId);
 
-    QStringList lineSplit = tLine.split("[|]");
+        main_list->removeClip(nClipId);
+        for (int i = 0; i < sub_lists.count(); i++) {
+            sub_lists.at(i)->removeClip(nClipId);
+        }
+        clipStore->removeClip(nClipId);
 
-    if (lineSplit.count() == 9) {
-        bool lineValid_flag = true;
+        journal->append(JOURNAL_REMOVE, cLine);
+        rFlag = true;
+    }
 
-        QString nShowName = lineSplit.at(0);
-        int nEpNum = lineSplit.at(1).toInt();
-        TimeBound nTime;
+    return rFlag;
+}
 
-        QStringList timeSplit = lineSplit.at(2).split("-");
+bool ClipDatabase::removeClipFromList(int nClipId, QString nListName) {
+    bool rFlag = false;
 
-        if (timeSplit.count() == 2) {
-            nTime.startTime = QTime::fromString(timeSplit.at(0), QString("hh:mm:ss"));
-            nTime.endTime = QTime::fromString(timeSplit.at(1), QString("hh:mm:ss"));
-        }
-        else {
-            lineValid_flag = false;
+    if (clipStore->contains(nClipId)) {
+        for (int i = 0; i < sub_lists.count(); i++) {
+            if (sub_lists.at(i)->getName() == nListName && sub_lists.at(i)->removeClip(nClipId)) {
+                rFlag = true;
+            }
         }
 
-        QString nSeason = lineSplit.at(3);
-        QStringList validSeasons;
-        validSeasons << "Spring" << "Summer" << "Fall" << "Winter";
-        if (!validSeasons.contains(nSeason, Qt::CaseInsensitive)) {
-            nSeason = "Spring";
+        if (rFlag) {
+            journal->append(JOURNAL_UNLIST, clipStore->clipLine(nClipId), QVector<QString>(1, nListName));
         }
+    }
 
-        int nYear = lineSplit.at(4).toInt();
+    return rFlag;
+}
 
-        QStringList tagSplit = lineSplit.at(5).split("|");
+// While on, lists append clips unsorted. Turning it off sorts every show once.
+void ClipDatabase::setBulkLoad(bool nBulk) {
+    bulkLoad_flag = nBulk;
 
-        QString nSource = lineSplit.at(6);
-        QString nLink = lineSplit.at(7);
-        QString nNote = lineSplit.at(8);
+    clipStore->setBulkLoad(nBulk);
 
+    main_list->setBulkInsert(nBulk);
+    for (int i = 0; i < sub_lists.count(); i++) {
+        sub_lists.at(i)->setBulkInsert(nBulk);
+    }
+}
 
-        if (lineValid_flag) {
-            rClip = addNewClip(nShowName, nEpNum, nTime, nLists);
-            rClip->season = nSeason;
-            rClip->year = nYear;
-            rClip->tags.append(tagSplit);
-            rClip->tags.removeDuplicates();
+// existingShows keeps the order the shows file was read in, which is the
+// order it is written back out. The set only answers membership.
+bool ClipDatabase::addExistingShow(const QString &nShowName) {
+    bool rFlag = false;
 
-            tagManager->addTags(tagSplit);
-            if (!rClip->localSrc.isEmpty() && nSource != rClip->localSrc) {
-                log->warn(QString("New Source does not match existing source. Curr=%1 New=%2").arg(rClip->localSrc).arg(nSource));
-            }
-            else {
-                rClip->localSrc = nSource;
-            }
-            if (!rClip->link.isEmpty() && nLink != rClip->link) {
-                log->warn(QString("New link does not match existing link. Curr=%1 New=%2").arg(rClip->link).arg(nLink));
-            }
-            else {
-                rClip->link = nLink;
-            }
-            if (!rClip->note.isEmpty() && nNote != rClip->note) {
-                log->warn(QString("New Note does not match existing note. Curr=%1 New=%2").arg(rClip->note).arg(nNote));
-            }
-            else {
-                rClip->note = nNote;
-            }
-        }
+    if (!existingShowIndex.contains(nShowName)) {
+        existingShowIndex.insert(nShowName);
+        existingShows.append(nShowName);
+        catalogChanged_flag = true;
+        rFlag = true;
     }
-    return rClip;
-}
 
-void  ClipDatabase::addExistingClip(Clip* /*nClip*/, QVector<ClipList*> /*nLists*/) {
+    return rFlag;
+}
 
+bool ClipDatabase::isBulkLoad() {
+    return bulkLoad_flag;
 }
 
 ClipList* ClipDatabase::initMainList() {
     if (main_list == NULL) {
-        main_list = new ClipList(log, this);
+        main_list = new ClipList(log, clipStore);
         main_list->setName("General");
     }
 
     return main_list;
 }
 
-Clip* ClipDatabase::clipExists(QString tShowName, int tEpNum, TimeBound tTime) {
-
-    bool exitList_flag = false;
-    Clip* rClip = NULL;
-    // In main list, find show, if show contains clip
-
-    ShowList *cShow = main_list->getShowList(tShowName);
+int ClipDatabase::clipExists(QString tShowName, int tEpNum, TimeBound tTime) {
+    int rClipId = -1;
+    int showId = stringPool->find(tShowName);
 
-    if (cShow != NULL) {
+    if (showId != -1) {
+        rClipId = clipStore->findClip(ClipKey(showId, tEpNum, tTime));
+    }
 
-        for (int j = 0; j < cShow->clips.count() && !exitList_flag; j++) {
-            Clip* cClip = cShow->clips.at(j);
+    return rClipId;
+}
 
-            bool epMatch_flag = (cClip->epNum == tEpNum);
-            bool startMatch_flag = (cClip->bounds.startTime == tTime.startTime);
-            bool endMatch_flag = (cClip->bounds.endTime == tTime.endTime);
+// Other clips in the same episode whose bounds overlap this one.
+QVector<int> ClipDatabase::findOverlappingClips(int nClipId) {
+    QVector<int> rIds;
 
-            if (epMatch_flag && startMatch_flag && endMatch_flag) {
-                exitList_flag = true;
-                rClip = cClip;
-            }
-        }
+    if (clipStore->contains(nClipId)) {
+        const Clip &cClip = clipStore->at(nClipId);
+        rIds = clipStore->getIntervalIndex().overlapping(cClip.showId, cClip.epNum,
+                                                         timeToMsecs(cClip.bounds.startTime),
+                                                         timeToMsecs(cClip.bounds.endTime));
+        rIds.removeOne(nClipId);
     }
 
-    return rClip;
+    return rIds;
 }
 
 TagManager* ClipDatabase::getTagManager() {
     return tagManager;
 }
+
+StringPool* ClipDatabase::getStringPool() {
+    return stringPool;
+}
+
+ClipStore* ClipDatabase::getClipStore() {
+    return clipStore;
+}
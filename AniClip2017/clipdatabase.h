@@ -6,52 +6,81 @@
 #include <QTime>
 #include <QStringList>
 #include <QTextStream>
+#include <QHash>
+#include <QSet>
+
+#include "clipstore.h"
 
 namespace logger {
     class Logger;
 }
 
-struct TimeBound {
-    QTime startTime;
-    QTime endTime;
+struct ClipLineFields;
+class StringPool;
+class ClipJournal;
+class SaveThread;
+
+// A parsed clip line that is not part of the database yet.
+struct ClipData {
+    QString     showName;
+    int         epNum;
+    TimeBound   bounds;
+    QString     season;
+    int         year;
+    QStringList tags;
+    QString     localSrc;
+    QString     link;
+    QString     note;
+
+    ClipData();
+
+    static ClipData fromFields(const ClipLineFields &nFields);
 };
 
-class TagGroup : public QObject
+// Tags of one group, in the order they were added. tagIndex answers
+// membership; the naturally sorted view is only built when someone asks for
+// the tags and is kept until the group changes.
+class TagGroup
 {
-    Q_OBJECT
 public:
-    explicit TagGroup(logger::Logger *nLog, QObject *parent = 0);
+    TagGroup(logger::Logger *nLog, StringPool *nPool);
 
     void setName(QString nName);
 
     bool addTag(QString nTag);
+    bool addTagId(int nTagId);
     bool addTags(QStringList nTags);
     bool removeTag(QString nTag);
 
+    bool containsTag(QString nTag);
+    int getTagCount();
+
     QStringList getTags();
+    QVector<int> getTagIds();
     QString getName();
+    int getNameId();
 
-    bool addGroup(TagGroup oGroup);
-
-    bool sortThis();
+    bool addGroup(const TagGroup &oGroup);
 
 private:
-    logger::Logger *log;
-
-    QString     groupName;
-    QStringList groupTags;
+    const QVector<int> &sortedTags();
 
-signals:
+    logger::Logger *log;
+    StringPool *stringPool;
 
-public slots:
+    int          groupNameId;
+    QVector<int> groupTags;
+    QSet<int>    tagIndex;
 
+    QVector<int> sortedTagIds;
+    bool         sorted_flag;
 };
 
-class TagManager : public QObject
+class TagManager
 {
-    Q_OBJECT
 public:
-    explicit TagManager(logger::Logger *nLog, QObject *parent = 0);
+    TagManager(logger::Logger *nLog, StringPool *nPool);
+    ~TagManager();
 
     bool readTagLine(QString line);
     bool addTag(QString tag, QString groupName = "");
@@ -64,86 +93,78 @@ public:
     QVector<TagGroup*> groups;
 
 private:
-    logger::Logger *log;
-
-    bool containsGroup(QString nName);
+    Q_DISABLE_COPY(TagManager)
 
+    logger::Logger *log;
+    StringPool *stringPool;
 
-signals:
-
-public slots:
+    QHash<int, TagGroup*> groupIndex;
 
+    bool containsGroup(QString nName);
 };
 
-class Clip : public QObject
-{
-    Q_OBJECT
-public:
-    explicit Clip(logger::Logger *nLog, QObject *parent = 0);
-
-    void setShowName(QString nShowName);
-    void setEpNum(int nEpNum);
-    void setTimeBound(TimeBound nTimeBound);
-
-    void writeClipToFile(QTextStream &nStream);
-
-    bool compareClip(Clip *oClip);
+// Sort key of a clip within its show: episode, then start, then end.
+struct ClipOrder {
+    int epNum;
+    int startMsecs;
+    int endMsecs;
 
-    QString     showName;
-    int         epNum;
-    TimeBound   bounds;
-    QString     season;
-    int         year;
-    QStringList tags;
-    QString     localSrc;
-    QString     link;
-    QString     note;
-
-private:
-    logger::Logger *log;
-
-signals:
+    ClipOrder();
+    explicit ClipOrder(const Clip &nClip);
 
-public slots:
+    bool operator<(const ClipOrder &oOrder) const;
 };
 
+Q_DECLARE_TYPEINFO(ClipOrder, Q_PRIMITIVE_TYPE);
 
-class ShowList : public QObject
+// Clips of one show within a ClipList, as ids into the ClipStore. clips is
+// kept in ClipOrder, with the keys cached alongside so inserts can binary
+// search without touching the store. In bulk mode clips are appended and
+// sorted once when bulk mode ends.
+class ShowList
 {
-    Q_OBJECT
 public:
-    explicit ShowList(logger::Logger *nLog, QObject *parent = 0);
+    ShowList(logger::Logger *nLog, ClipStore *nStore);
+
+    bool addClip(int nClipId);
+    bool removeClip(int nClipId);
 
-    bool addClip(Clip *nClip);
+    void setBulkInsert(bool nBulk);
+    void sortClips();
 
-    void writeListToFile(QTextStream &nStream);
     QString getName();
+    int getShowId();
     void setName(QString nName);
+    void setShowId(int nShowId);
 
     int getClipCount();
 
-    QVector<Clip*> clips;
+    QVector<int> clips;
 
 private:
-    void insertClip(Clip *nClip);
+    void insertClip(int nClipId);
 
     logger::Logger *log;
+    ClipStore *clipStore;
 
-    QString showName;
-signals:
+    int showId;
+    QSet<int> clipIndex;
+    QVector<ClipOrder> order;
 
-public slots:
+    bool bulk_flag;
+    bool sorted_flag;
 };
 
-class ClipList : public QObject
+class ClipList
 {
-    Q_OBJECT
 public:
-    explicit ClipList(logger::Logger *nLog, QObject *parent = 0);
+    ClipList(logger::Logger *nLog, ClipStore *nStore);
+    ~ClipList();
 
-    bool addClip(Clip* nClip);
+    bool addClip(int nClipId);
+    bool removeClip(int nClipId);
 
-    void writeListToFile(QTextStream &nStream);
+    void setBulkInsert(bool nBulk);
 
     void setVisible(bool isVisible);
     bool isVisible();
@@ -155,21 +176,24 @@ public:
     int getClipCount();
 
     ShowList* getShowList(QString show_name);
+    ShowList* getShowList(int show_id);
 
 
 private:
+    Q_DISABLE_COPY(ClipList)
+
     logger::Logger *log;
+    ClipStore *clipStore;
+
+    bool bulk_flag;
+    QHash<int, ShowList*> showIndex;
 
 public:
 
-    QString listName;
+    int listNameId;
     QVector<ShowList*> shows;
 
     bool isVisible_flag;
-
-signals:
-
-public slots:
 };
 
 class ClipDatabase : public QObject
@@ -177,32 +201,45 @@ class ClipDatabase : public QObject
     Q_OBJECT
 public:
     explicit ClipDatabase(logger::Logger *nLog, QObject *parent = 0);
+    ~ClipDatabase();
 
     bool init(QString config_filename);
     bool readConfig(QString config_filename);
     void selfTest();
 
     void save();
-    void saveClips();
-    void saveShows();
-    void saveTags();
-    void writeBackup();
+    void compact();
+    void waitForSave();
+    bool isSaving();
+    bool restoreBackup(QString generation);
+    QStringList getBackups();
 
     bool loadClips(QString clipList_filename);
+    bool loadSnapshot(QString clipList_filename);
     bool loadShowList(QString showList_filename);
     bool loadTagList(QString tagList_filename);
 
-    Clip* addNewClip(QString showName, int epNum, TimeBound time, QVector<QString> nLists);
-    Clip* addNewClip(QString clipLine, QVector<QString> nLists);
-    void  addExistingClip(Clip* nClip, QVector<ClipList*> nLists);
+    int   addNewClip(QString showName, int epNum, TimeBound time, QVector<QString> nLists);
+    int   addNewClip(QString clipLine, QVector<QString> nLists);
+    int   addNewClip(const ClipData &nData, QVector<QString> nLists);
+    void  addExistingClip(int nClipId, QVector<ClipList*> nLists);
+    bool  editClip(int nClipId, const ClipData &nData);
+    bool  removeClip(int nClipId);
+    bool  removeClipFromList(int nClipId, QString nListName);
+    int   clipExists(QString tShowName, int tEpNum, TimeBound tTime);
+    QVector<int> findOverlappingClips(int nClipId);
 
     ClipList* initMainList();
+    void setBulkLoad(bool nBulk);
+    bool isBulkLoad();
 
     TagManager *getTagManager();
+    StringPool *getStringPool();
+    ClipStore *getClipStore();
 
-private:
-    Clip* clipExists(QString tShowName, int tEpNum, TimeBound tTime);
+    bool addExistingShow(const QString &nShowName);
 
+private:
     logger::Logger *log;
 
 
@@ -210,20 +247,40 @@ public:
 
     ClipList* main_list;
     QStringList existingShows;
+    QSet<QString> existingShowIndex;
 
-    QVector<Clip*> used_clips;
     QVector<ClipList*> sub_lists;
 
+    StringPool *stringPool;
+    ClipStore *clipStore;
     TagManager *tagManager;
+    ClipJournal *journal;
+    SaveThread *saveThread;
 
     QString clips_filename;
     QString tags_filename;
     QString shows_filename;
 
+    bool snapshot_flag;
+    bool bulkLoad_flag;
+    bool catalogChanged_flag;
+    int journalCompact_records;
+
+    int backupRecent;
+    int backupDaily;
+    int backupWeekly;
+    int backupFullEvery;
+
 signals:
     void infoUpdated(const QString &);
+    void saveStarted();
+    void saveProgress(int nPercent, const QString &nStage);
+    void saveFinished(bool nSuccess);
 
 public slots:
+
+private slots:
+    void onSaveFinished(bool nSuccess, int nSegment);
 };
 
 #endif // CLIPDATABASE_H
@@ -0,0 +1,330 @@
+#include "clipjournal.h"
+#include "clipdatabase.h"
+#include "clipparser.h"
+#include "logger.h"
+#include "tracer.h"
+
+#include <QByteArray>
+#include <QFileInfo>
+#include <QDir>
+#include <QtAlgorithms>
+
+#ifdef Q_OS_WIN
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+static const char *JOURNAL_OPS[] = { "ADD", "EDIT", "REMOVE", "UNLIST" };
+static const int NUM_JOURNAL_OPS = 4;
+
+// List names are user text and may hold the tab and newline that delimit records.
+static QString escapeField(QString nField) {
+    return nField.replace("\\", "\\\\").replace("\t", "\\t").replace("\n", "\\n").replace("\r", "\\r");
+}
+
+static QString unescapeField(const QString &nField) {
+    QString rField;
+    rField.reserve(nField.size());
+
+    for (int i = 0; i < nField.size(); i++) {
+        QChar c = nField.at(i);
+        if (c == '\\' && i + 1 < nField.size()) {
+            QChar e = nField.at(++i);
+            if (e == 't') {
+                rField += '\t';
+            }
+            else if (e == 'n') {
+                rField += '\n';
+            }
+            else if (e == 'r') {
+                rField += '\r';
+            }
+            else {
+                rField += e;
+            }
+        }
+        else {
+            rField += c;
+        }
+    }
+
+    return rField;
+}
+
+ClipJournal::ClipJournal(logger::Logger *nLog) :
+    log(nLog),
+    journalFile(),
+    clipsFilename(),
+    validSize(-1),
+    numRecords(0),
+    lastSegment(0)
+{
+
+}
+
+ClipJournal::~ClipJournal() {
+    close();
+}
+
+QString ClipJournal::journalFilename(QString clipList_filename) {
+    return clipList_filename + ".journal";
+}
+
+QString ClipJournal::segmentFilename(QString clipList_filename, int nSegment) {
+    return QString("%1.%2").arg(journalFilename(clipList_filename)).arg(nSegment);
+}
+
+QVector<int> ClipJournal::segments(QString clipList_filename) {
+    QVector<int> rSegments;
+    QFileInfo journalInfo(journalFilename(clipList_filename));
+    QStringList entries = journalInfo.absoluteDir().entryList(QStringList() << journalInfo.fileName() + ".*", QDir::Files);
+
+    for (int i = 0; i < entries.count(); i++) {
+        bool number_flag = false;
+        int nSegment = entries.at(i).mid(journalInfo.fileName().length() + 1).toInt(&number_flag);
+        if (number_flag) {
+            rSegments.append(nSegment);
+        }
+    }
+    qSort(rSegments);
+
+    return rSegments;
+}
+
+// Replays the closed segments oldest first, then the live journal.
+bool ClipJournal::replay(ClipDatabase *db, QString clipList_filename) {
+    logger::TraceSpan span("ClipJournal.replay");
+    bool replaySuccess_flag = true;
+    QVector<int> pending = segments(clipList_filename);
+    qint64 segmentSize = 0;
+
+    numRecords = 0;
+    validSize = 0;
+    lastSegment = 0;
+
+    for (int i = 0; i < pending.count(); i++) {
+        if (!replayFile(db, segmentFilename(clipList_filename, pending.at(i)), segmentSize)) {
+            replaySuccess_flag = false;
+        }
+        lastSegment = pending.at(i);
+    }
+
+    if (!replayFile(db, journalFilename(clipList_filename), validSize)) {
+        replaySuccess_flag = false;
+    }
+
+    return replaySuccess_flag;
+}
+
+bool ClipJournal::replayFile(ClipDatabase *db, QString filename, qint64 &rValidSize) {
+    bool replaySuccess_flag = true;
+    QFile replayFile(filename);
+
+    rValidSize = 0;
+
+    if (replayFile.exists()) {
+        if (replayFile.open(QIODevice::ReadOnly)) {
+            QByteArray contents = replayFile.readAll();
+            int numApplied = 0;
+            int numRead = 0;
+            int lineStart = 0;
+            int lineEnd = contents.indexOf('\n');
+
+            while (lineEnd != -1) {
+                QString record = QString::fromUtf8(contents.constData() + lineStart, lineEnd - lineStart);
+                if (record.endsWith('\r')) {
+                    record.chop(1);
+                }
+
+                if (!record.isEmpty()) {
+                    if (applyRecord(db, record)) {
+                        numApplied++;
+                    }
+                    else {
+                        log->warn("ClipJournal.replay: Skipped invalid record \"%1\".", record);
+                    }
+                    numRead++;
+                }
+
+                lineStart = lineEnd + 1;
+                lineEnd = contents.indexOf('\n', lineStart);
+            }
+
+            rValidSize = lineStart;
+            if (rValidSize < contents.size()) {
+                log->warn(QString("ClipJournal.replay: Dropped %1 bytes of a torn record.").arg(contents.size() - rValidSize));
+            }
+
+            if (numRead > 0) {
+                log->info(QString("ClipJournal.replay: Applied %1 of %2 records from \"%3\".").arg(numApplied).arg(numRead).arg(replayFile.fileName()));
+            }
+            numRecords += numRead;
+        }
+        else {
+            log->err(QString("ClipJournal.replay: Unable to open \"%1\". %2").arg(replayFile.fileName()).arg(replayFile.errorString()));
+            replaySuccess_flag = false;
+        }
+    }
+
+    return replaySuccess_flag;
+}
+
+bool ClipJournal::open(QString clipList_filename) {
+    close();
+
+    clipsFilename = clipList_filename;
+    journalFile.setFileName(journalFilename(clipList_filename));
+
+    if (validSize >= 0 && journalFile.exists() && journalFile.size() > validSize) {
+        journalFile.resize(validSize);
+    }
+
+    bool openSuccess_flag = journalFile.open(QIODevice::WriteOnly | QIODevice::Append);
+    if (!openSuccess_flag) {
+        log->err(QString("ClipJournal.open: Unable to open \"%1\". %2").arg(journalFile.fileName()).arg(journalFile.errorString()));
+    }
+
+    return openSuccess_flag;
+}
+
+void ClipJournal::close() {
+    if (journalFile.isOpen()) {
+        journalFile.flush();
+        if (!sync()) {
+            log->warn(QString("ClipJournal.close: Unable to sync \"%1\".").arg(journalFile.fileName()));
+        }
+        journalFile.close();
+    }
+}
+
+// QFile::flush only hands the data to the operating system.
+bool ClipJournal::sync() {
+#ifdef Q_OS_WIN
+    return ::_commit(journalFile.handle()) == 0;
+#else
+    return ::fsync(journalFile.handle()) == 0;
+#endif
+}
+
+bool ClipJournal::isOpen() const {
+    return journalFile.isOpen();
+}
+
+bool ClipJournal::append(JournalOp nOp, const QString &nClipLine, const QVector<QString> &nLists) {
+    bool appendSuccess_flag = false;
+
+    if (journalFile.isOpen()) {
+        QString record = QString("%1\t%2\t").arg(JOURNAL_OPS[nOp]).arg(nLists.count());
+        for (int i = 0; i < nLists.count(); i++) {
+            record += escapeField(nLists.at(i)) + "\t";
+        }
+        record += nClipLine + "\n";
+
+        QByteArray data = record.toUtf8();
+        appendSuccess_flag = (journalFile.write(data) == data.size()) && journalFile.flush();
+
+        if (appendSuccess_flag) {
+            numRecords++;
+        }
+        else {
+            log->err(QString("ClipJournal.append: Write to \"%1\" failed. %2").arg(journalFile.fileName()).arg(journalFile.errorString()));
+        }
+    }
+
+    return appendSuccess_flag;
+}
+
+// Syncs and closes the live journal as the next numbered segment and starts
+// an empty one. Returns the segment number, or -1 if the journal could not be
+// rotated.
+int ClipJournal::rotate() {
+    int rSegment = -1;
+
+    if (journalFile.isOpen()) {
+        close();
+
+        int nSegment = lastSegment + 1;
+        if (QFile::rename(journalFilename(clipsFilename), segmentFilename(clipsFilename, nSegment))) {
+            lastSegment = nSegment;
+            rSegment = nSegment;
+            numRecords = 0;
+            validSize = 0;
+        }
+        else {
+            log->err(QString("ClipJournal.rotate: Unable to close segment %1 of \"%2\".").arg(nSegment).arg(journalFile.fileName()));
+        }
+
+        open(clipsFilename);
+    }
+
+    return rSegment;
+}
+
+// Deletes the segments whose records are now part of the full files.
+void ClipJournal::dropSegments(int nUpTo) {
+    QVector<int> pending = segments(clipsFilename);
+
+    for (int i = 0; i < pending.count() && pending.at(i) <= nUpTo; i++) {
+        if (!QFile::remove(segmentFilename(clipsFilename, pending.at(i)))) {
+            log->warn(QString("ClipJournal.dropSegments: Unable to remove segment %1.").arg(pending.at(i)));
+        }
+    }
+}
+
+int ClipJournal::getRecordCount() const {
+    return numRecords;
+}
+
+bool ClipJournal::applyRecord(ClipDatabase *db, const QString &nRecord) {
+    bool applied_flag = false;
+
+    QString opName = nRecord.section('\t', 0, 0);
+    bool count_flag = false;
+    int numLists = nRecord.section('\t', 1, 1).toInt(&count_flag);
+
+    int op = -1;
+    for (int i = 0; i < NUM_JOURNAL_OPS && op == -1; i++) {
+        if (opName == JOURNAL_OPS[i]) {
+            op = i;
+        }
+    }
+
+    if (op != -1 && count_flag && numLists >= 0) {
+        QVector<QString> nLists;
+        for (int i = 0; i < numLists; i++) {
+            nLists.append(unescapeField(nRecord.section('\t', 2 + i, 2 + i)));
+        }
+
+        QByteArray clipLine = nRecord.section('\t', 2 + numLists).toUtf8();
+        ClipLineFields fields;
+
+        if (ClipLineParser::parse(FieldView(clipLine.constData(), clipLine.size()), fields)) {
+            ClipData nData = ClipData::fromFields(fields);
+
+            if (op == JOURNAL_ADD) {
+                applied_flag = (db->addNewClip(nData, nLists) != -1);
+            }
+            else {
+                int clipId = db->clipExists(nData.showName, nData.epNum, nData.bounds);
+                applied_flag = true;
+
+                if (clipId != -1) {
+                    if (op == JOURNAL_EDIT) {
+                        db->editClip(clipId, nData);
+                    }
+                    else if (op == JOURNAL_REMOVE) {
+                        db->removeClip(clipId);
+                    }
+                    else if (op == JOURNAL_UNLIST) {
+                        for (int i = 0; i < nLists.count(); i++) {
+                            db->removeClipFromList(clipId, nLists.at(i));
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    return applied_flag;
+}
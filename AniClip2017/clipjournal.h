@@ -0,0 +1,74 @@
+#ifndef CLIPJOURNAL_H
+#define CLIPJOURNAL_H
+
+#include <QString>
+#include <QVector>
+#include <QFile>
+
+namespace logger {
+class Logger;
+}
+
+class ClipDatabase;
+
+enum JournalOp {
+    JOURNAL_ADD,
+    JOURNAL_EDIT,
+    JOURNAL_REMOVE,
+    JOURNAL_UNLIST
+};
+
+// Append-only log of the changes made to the database since the clip file was
+// last written in full. Each record is one line:
+//
+//  op \t listCount \t listName... \t clipLine
+//
+// List names escape backslash, tab, CR and newline as \\, \t, \r and \n.
+//
+// Records are flushed as they are appended, which survives the process
+// crashing but not the system; the file is only synced to disk when it is
+// rotated or closed. A record without its trailing newline was torn by a
+// crash and is dropped on replay. Replaying a record a second time leaves the
+// database unchanged, so a crash between writing the full files and dropping
+// the journal loses nothing.
+//
+// A save rotates the live journal into a numbered segment (<journal>.N) and
+// keeps appending to a fresh one, so edits made while a save is running are
+// never mixed into the records that save covers. Once the full files are
+// committed, segments up to N are dropped.
+class ClipJournal
+{
+public:
+    explicit ClipJournal(logger::Logger *nLog);
+    ~ClipJournal();
+
+    static QString journalFilename(QString clipList_filename);
+    static QString segmentFilename(QString clipList_filename, int nSegment);
+    static QVector<int> segments(QString clipList_filename);
+
+    bool replay(ClipDatabase *db, QString clipList_filename);
+    bool open(QString clipList_filename);
+    void close();
+    bool isOpen() const;
+
+    bool append(JournalOp nOp, const QString &nClipLine, const QVector<QString> &nLists = QVector<QString>());
+    int rotate();
+    void dropSegments(int nUpTo);
+
+    int getRecordCount() const;
+
+private:
+    bool sync();
+    bool replayFile(ClipDatabase *db, QString filename, qint64 &rValidSize);
+    bool applyRecord(ClipDatabase *db, const QString &nRecord);
+
+    logger::Logger *log;
+
+    QFile journalFile;
+    QString clipsFilename;
+    qint64 validSize;
+    int numRecords;
+    int lastSegment;
+};
+
+#endif // CLIPJOURNAL_H
@@ -0,0 +1,205 @@
+#include "cliploader.h"
+#include "clipparser.h"
+#include "logger.h"
+#include "tracer.h"
+
+#include <QFile>
+#include <QTextCodec>
+#include <QThread>
+#include <QThreadPool>
+#include <QtAlgorithms>
+
+#include <string.h>
+
+static const int BLOCK_LINES = 8192;
+
+ClipBatchTask::ClipBatchTask(const ClipBlock &nBlock) :
+    QRunnable(),
+    block(nBlock),
+    batch()
+{
+    setAutoDelete(false);
+}
+
+void ClipBatchTask::run() {
+    const char *cPos = block.begin;
+    FieldView line;
+    ClipLineFields fields;
+
+    while (ClipLineParser::nextLine(cPos, block.end, line)) {
+        if (!line.isEmpty() && !line.startsWith("#") && !line.startsWith("List::") &&
+            !line.startsWith("{") && !line.startsWith("}")) {
+
+            if (ClipLineParser::parse(line, fields)) {
+                batch.append(ClipData::fromFields(fields));
+            }
+        }
+    }
+}
+
+ClipFileLoader::ClipFileLoader(logger::Logger *nLog, ClipDatabase *nDb) :
+    log(nLog),
+    clipDB(nDb),
+    tasks()
+{
+
+}
+
+bool ClipFileLoader::load(QString clipList_filename) {
+    logger::TraceSpan span("ClipFileLoader.load");
+    bool importSuccess_flag = false;
+
+    QFile clipsFile(clipList_filename);
+    if (clipsFile.open(QIODevice::ReadOnly)) {
+        importSuccess_flag = true;
+
+        QByteArray contents;
+        const char *data = NULL;
+        qint64 dataSize = clipsFile.size();
+
+        uchar *mapped = clipsFile.map(0, dataSize);
+        if (mapped != NULL) {
+            data = reinterpret_cast<const char*>(mapped);
+        }
+        else {
+            contents = clipsFile.readAll();
+            data = contents.constData();
+            dataSize = contents.size();
+        }
+
+        const char *cPos = data;
+        if (dataSize >= 3 && memcmp(cPos, "\xEF\xBB\xBF", 3) == 0) {
+            cPos += 3;
+        }
+
+        // Older files are in the locale codec; parse a UTF-8 copy of them.
+        // The next save writes the file back as UTF-8.
+        QByteArray converted;
+        const char *cEnd = data + dataSize;
+        if (!ClipLineParser::isUtf8(cPos, cEnd - cPos)) {
+            log->info(QString("Converting \"%1\" from the locale encoding to UTF-8.").arg(clipList_filename));
+            converted = QTextCodec::codecForLocale()->toUnicode(cPos, cEnd - cPos).toUtf8();
+            cPos = converted.constData();
+            cEnd = cPos + converted.size();
+        }
+
+        scanBlocks(cPos, cEnd);
+        parseBlocks();
+        mergeBlocks();
+
+        qDeleteAll(tasks);
+        tasks.clear();
+
+        if (mapped != NULL) {
+            clipsFile.unmap(mapped);
+        }
+
+        log->info(QString("Added %1 new Clips.").arg(clipDB->main_list->getClipCount()));
+    }
+    else {
+        log->warn(QString("Unable to open file \"%1\".").arg(clipList_filename));
+    }
+
+    return importSuccess_flag;
+}
+
+void ClipFileLoader::addBlock(const QString &nListName, const char *nBegin, const char *nEnd, bool nListEnd) {
+    if (nBegin < nEnd || nListEnd) {
+        ClipBlock nBlock;
+        nBlock.listName     = nListName;
+        nBlock.begin        = nBegin;
+        nBlock.end          = nEnd;
+        nBlock.listEnd_flag = nListEnd;
+        tasks.append(new ClipBatchTask(nBlock));
+    }
+}
+
+void ClipFileLoader::scanBlocks(const char *nBegin, const char *nEnd) {
+    const char *cPos = nBegin;
+    const char *lineStart = nBegin;
+    const char *blockStart = nBegin;
+    int blockLines = 0;
+
+    bool withinList_flag = false;
+    QString cListName = "";
+    FieldView line;
+
+    while (ClipLineParser::nextLine(cPos, nEnd, line)) {
+        if (!line.startsWith("#") && !line.isEmpty()) {
+            if (!withinList_flag) {
+                if (line.startsWith("List::")) {
+                    addBlock(cListName, blockStart, lineStart, false);
+                    cListName = line.mid(6).toString();
+                    withinList_flag = true;
+                    blockStart = cPos;
+                    blockLines = 0;
+                }
+            }
+            else {
+                if (line.startsWith("List::")) {
+                    log->err("Already within list %1. Invalid entry \"%2\"", cListName, line.toString());
+                }
+
+                if (line.startsWith("}")) {
+                    addBlock(cListName, blockStart, lineStart, true);
+                    cListName = "";
+                    withinList_flag = false;
+                    blockStart = cPos;
+                    blockLines = 0;
+                }
+            }
+        }
+
+        blockLines++;
+        if (blockLines >= BLOCK_LINES) {
+            addBlock(cListName, blockStart, cPos, false);
+            blockStart = cPos;
+            blockLines = 0;
+        }
+
+        lineStart = cPos;
+    }
+
+    addBlock(cListName, blockStart, nEnd, false);
+}
+
+void ClipFileLoader::parseBlocks() {
+    if (tasks.count() == 1) {
+        tasks.first()->run();
+    }
+    else if (tasks.count() > 1) {
+        QThreadPool pool;
+        pool.setMaxThreadCount(QThread::idealThreadCount());
+
+        for (int i = 0; i < tasks.count(); i++) {
+            pool.start(tasks.at(i));
+        }
+
+        pool.waitForDone();
+    }
+}
+
+void ClipFileLoader::mergeBlocks() {
+    int numAddedtoList = 0;
+
+    for (int i = 0; i < tasks.count(); i++) {
+        ClipBatchTask *cTask = tasks.at(i);
+        QVector<QString> nLists(1, cTask->block.listName);
+
+        for (int j = 0; j < cTask->batch.count(); j++) {
+            if (clipDB->addNewClip(cTask->batch.at(j), nLists) != -1) {
+                numAddedtoList++;
+            }
+        }
+
+        if (cTask->block.listEnd_flag) {
+            log->info("Loaded %1 clips to list %2", numAddedtoList, cTask->block.listName);
+            numAddedtoList = 0;
+        }
+        else if (i + 1 < tasks.count() && tasks.at(i + 1)->block.listName != cTask->block.listName) {
+            numAddedtoList = 0;
+        }
+
+        cTask->batch.clear();
+    }
+}
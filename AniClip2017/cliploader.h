@@ -0,0 +1,56 @@
+#ifndef CLIPLOADER_H
+#define CLIPLOADER_H
+
+#include <QString>
+#include <QVector>
+#include <QRunnable>
+
+#include "clipdatabase.h"
+
+namespace logger {
+class Logger;
+}
+
+// A run of clip lines that all belong to the same list.
+struct ClipBlock {
+    QString     listName;
+    const char *begin;
+    const char *end;
+    bool        listEnd_flag;
+};
+
+// Parses one ClipBlock into a batch owned by the task.
+class ClipBatchTask : public QRunnable
+{
+public:
+    explicit ClipBatchTask(const ClipBlock &nBlock);
+
+    void run();
+
+    ClipBlock           block;
+    QVector<ClipData>   batch;
+};
+
+// Loads the clip file in three passes: find list block boundaries, parse the
+// blocks on a thread pool, then merge the batches into the database in file
+// order so the result is the same as a serial load.
+class ClipFileLoader
+{
+public:
+    ClipFileLoader(logger::Logger *nLog, ClipDatabase *nDb);
+
+    bool load(QString clipList_filename);
+
+private:
+    void scanBlocks(const char *nBegin, const char *nEnd);
+    void addBlock(const QString &nListName, const char *nBegin, const char *nEnd, bool nListEnd);
+    void parseBlocks();
+    void mergeBlocks();
+
+    logger::Logger *log;
+    ClipDatabase *clipDB;
+
+    QVector<ClipBatchTask*> tasks;
+};
+
+#endif // CLIPLOADER_H
@@ -0,0 +1,324 @@
+#include "clipparser.h"
+
+#include <QTextCodec>
+
+#include <string.h>
+
+static const char *SEASON_NAMES[SEASON_COUNT] = { "Spring", "Summer", "Fall", "Winter" };
+
+static bool isSpace(char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\v' || c == '\f';
+}
+
+static char toLowerAscii(char c) {
+    return (c >= 'A' && c <= 'Z') ? char(c - 'A' + 'a') : c;
+}
+
+static int twoDigits(const char *nPos) {
+    int rValue = -1;
+    if (nPos[0] >= '0' && nPos[0] <= '9' && nPos[1] >= '0' && nPos[1] <= '9') {
+        rValue = (nPos[0] - '0') * 10 + (nPos[1] - '0');
+    }
+    return rValue;
+}
+
+FieldView::FieldView() :
+    data(NULL),
+    length(0)
+{
+
+}
+
+FieldView::FieldView(const char *nData, int nLength) :
+    data(nData),
+    length(nLength)
+{
+
+}
+
+bool FieldView::isEmpty() const {
+    return length == 0;
+}
+
+bool FieldView::startsWith(const char *nPrefix) const {
+    int prefixLength = strlen(nPrefix);
+    return length >= prefixLength && memcmp(data, nPrefix, prefixLength) == 0;
+}
+
+bool FieldView::equals(const FieldView &oView) const {
+    return length == oView.length && (length == 0 || memcmp(data, oView.data, length) == 0);
+}
+
+FieldView FieldView::mid(int nPos) const {
+    FieldView rView(data + length, 0);
+    if (nPos < length) {
+        rView = FieldView(data + nPos, length - nPos);
+    }
+    return rView;
+}
+
+FieldView FieldView::trimmed() const {
+    int start = 0;
+    int end = length;
+
+    while (start < end && isSpace(data[start])) {
+        start++;
+    }
+    while (end > start && isSpace(data[end - 1])) {
+        end--;
+    }
+
+    return FieldView(data + start, end - start);
+}
+
+QString FieldView::toString() const {
+    return QString::fromUtf8(data, length);
+}
+
+bool ClipLineParser::nextLine(const char *&rPos, const char *nEnd, FieldView &rLine) {
+    bool rFlag = false;
+
+    if (rPos < nEnd) {
+        const char *lineEnd = static_cast<const char*>(memchr(rPos, '\n', nEnd - rPos));
+        const char *nextPos = nEnd;
+
+        if (lineEnd != NULL) {
+            nextPos = lineEnd + 1;
+        }
+        else {
+            lineEnd = nEnd;
+        }
+
+        if (lineEnd > rPos && lineEnd[-1] == '\r') {
+            lineEnd--;
+        }
+
+        rLine = FieldView(rPos, lineEnd - rPos);
+        rPos = nextPos;
+        rFlag = true;
+    }
+
+    return rFlag;
+}
+
+bool ClipLineParser::parse(FieldView nLine, ClipLineFields &rFields) {
+    FieldView line = nLine.trimmed();
+    FieldView fields[NUM_FIELDS];
+    int numFields = 0;
+
+    const char *cStart = line.data;
+    const char *cPos = line.data;
+    const char *cEnd = line.data + line.length;
+
+    while (cPos + 3 <= cEnd) {
+        if (cPos[0] == '[' && cPos[1] == '|' && cPos[2] == ']') {
+            if (numFields < NUM_FIELDS) {
+                fields[numFields] = FieldView(cStart, cPos - cStart);
+            }
+            numFields++;
+            cPos += 3;
+            cStart = cPos;
+        }
+        else {
+            cPos++;
+        }
+    }
+
+    if (numFields < NUM_FIELDS) {
+        fields[numFields] = FieldView(cStart, cEnd - cStart);
+    }
+    numFields++;
+
+    bool lineValid_flag = (numFields == NUM_FIELDS);
+
+    if (lineValid_flag) {
+        FieldView timeField = fields[2];
+        const char *dash = static_cast<const char*>(memchr(timeField.data, '-', timeField.length));
+
+        if (dash != NULL && memchr(dash + 1, '-', timeField.data + timeField.length - (dash + 1)) == NULL) {
+            rFields.startMsecs = parseTime(FieldView(timeField.data, dash - timeField.data));
+            rFields.endMsecs   = parseTime(FieldView(dash + 1, timeField.data + timeField.length - (dash + 1)));
+        }
+        else {
+            lineValid_flag = false;
+        }
+
+        rFields.showName    = fields[0];
+        rFields.epNum       = parseInt(fields[1]);
+        rFields.season      = parseSeason(fields[3]);
+        rFields.year        = parseInt(fields[4]);
+        rFields.tags        = fields[5];
+        rFields.source      = fields[6];
+        rFields.link        = fields[7];
+        rFields.note        = fields[8];
+    }
+
+    return lineValid_flag;
+}
+
+bool ClipLineParser::nextTag(FieldView &rTags, FieldView &rTag) {
+    bool rFlag = false;
+
+    if (rTags.data != NULL) {
+        const char *cEnd = rTags.data + rTags.length;
+        const char *bar = static_cast<const char*>(memchr(rTags.data, '|', rTags.length));
+
+        if (bar != NULL) {
+            rTag = FieldView(rTags.data, bar - rTags.data);
+            rTags = FieldView(bar + 1, cEnd - (bar + 1));
+        }
+        else {
+            rTag = rTags;
+            rTags = FieldView();
+        }
+        rFlag = true;
+    }
+
+    return rFlag;
+}
+
+// Same results as QString::toInt: 0 for anything that is not a plain base 10 int.
+int ClipLineParser::parseInt(FieldView nField) {
+    FieldView field = nField.trimmed();
+    int pos = 0;
+    bool negative_flag = false;
+
+    if (pos < field.length && (field.data[pos] == '-' || field.data[pos] == '+')) {
+        negative_flag = (field.data[pos] == '-');
+        pos++;
+    }
+
+    bool valid_flag = (pos < field.length);
+    qint64 value = 0;
+
+    for (; pos < field.length && valid_flag; pos++) {
+        char c = field.data[pos];
+        if (c >= '0' && c <= '9') {
+            value = value * 10 + (c - '0');
+            if (value > qint64(0x7fffffff) + 1) {
+                valid_flag = false;
+            }
+        }
+        else {
+            valid_flag = false;
+        }
+    }
+
+    if (negative_flag) {
+        value = -value;
+    }
+
+    int rValue = 0;
+    if (valid_flag && value >= -qint64(0x7fffffff) - 1 && value <= qint64(0x7fffffff)) {
+        rValue = int(value);
+    }
+
+    return rValue;
+}
+
+// Strict "hh:mm:ss". Returns msecs since midnight, or -1 like an invalid QTime.
+int ClipLineParser::parseTime(FieldView nField) {
+    int rMsecs = -1;
+
+    if (nField.length == 8 && nField.data[2] == ':' && nField.data[5] == ':') {
+        int hours   = twoDigits(nField.data);
+        int minutes = twoDigits(nField.data + 3);
+        int seconds = twoDigits(nField.data + 6);
+
+        if (hours >= 0 && hours < 24 && minutes >= 0 && minutes < 60 && seconds >= 0 && seconds < 60) {
+            rMsecs = ((hours * 60 + minutes) * 60 + seconds) * 1000;
+        }
+    }
+
+    return rMsecs;
+}
+
+SeasonType ClipLineParser::parseSeason(FieldView nField) {
+    SeasonType rSeason = SEASON_SPRING;
+    bool found_flag = false;
+
+    for (int i = 0; i < SEASON_COUNT && !found_flag; i++) {
+        const char *cName = SEASON_NAMES[i];
+        int nameLength = strlen(cName);
+
+        if (nameLength == nField.length) {
+            found_flag = true;
+            for (int j = 0; j < nameLength && found_flag; j++) {
+                if (toLowerAscii(nField.data[j]) != toLowerAscii(cName[j])) {
+                    found_flag = false;
+                }
+            }
+
+            if (found_flag) {
+                rSeason = SeasonType(i);
+            }
+        }
+    }
+
+    return rSeason;
+}
+
+QString ClipLineParser::seasonName(SeasonType nSeason) {
+    static const QString names[SEASON_COUNT] = {
+        QString(SEASON_NAMES[SEASON_SPRING]),
+        QString(SEASON_NAMES[SEASON_SUMMER]),
+        QString(SEASON_NAMES[SEASON_FALL]),
+        QString(SEASON_NAMES[SEASON_WINTER])
+    };
+
+    QString rName = names[SEASON_SPRING];
+    if (nSeason >= 0 && nSeason < SEASON_COUNT) {
+        rName = names[nSeason];
+    }
+    return rName;
+}
+
+// True if nData is well formed UTF-8. Files written before saves switched to
+// UTF-8 used the locale codec and almost never pass.
+bool ClipLineParser::isUtf8(const char *nData, qint64 nSize) {
+    const uchar *cPos = reinterpret_cast<const uchar*>(nData);
+    const uchar *cEnd = cPos + nSize;
+    bool rFlag = true;
+
+    while (rFlag && cPos < cEnd) {
+        int trail = 0;
+        if (*cPos < 0x80) {
+            trail = 0;
+        }
+        else if (*cPos >= 0xC2 && *cPos <= 0xDF) {
+            trail = 1;
+        }
+        else if (*cPos >= 0xE0 && *cPos <= 0xEF) {
+            trail = 2;
+        }
+        else if (*cPos >= 0xF0 && *cPos <= 0xF4) {
+            trail = 3;
+        }
+        else {
+            rFlag = false;
+        }
+
+        cPos++;
+        for (int i = 0; rFlag && i < trail; i++, cPos++) {
+            rFlag = cPos < cEnd && (*cPos & 0xC0) == 0x80;
+        }
+    }
+
+    return rFlag;
+}
+
+// Text of a clip, show or tag file: UTF-8 if it is valid UTF-8, otherwise
+// the locale codec the files used to be written with.
+QString ClipLineParser::decodeText(const QByteArray &nBytes) {
+    QString rText;
+    int start = nBytes.startsWith("\xEF\xBB\xBF") ? 3 : 0;
+
+    if (isUtf8(nBytes.constData() + start, nBytes.size() - start)) {
+        rText = QString::fromUtf8(nBytes.constData() + start, nBytes.size() - start);
+    }
+    else {
+        rText = QTextCodec::codecForLocale()->toUnicode(nBytes);
+    }
+
+    return rText;
+}
@@ -0,0 +1,68 @@
+#ifndef CLIPPARSER_H
+#define CLIPPARSER_H
+
+#include <QString>
+#include <QByteArray>
+
+// Non-owning view of UTF-8 bytes inside a line buffer.
+struct FieldView {
+    const char *data;
+    int         length;
+
+    FieldView();
+    FieldView(const char *nData, int nLength);
+
+    bool isEmpty() const;
+    bool startsWith(const char *nPrefix) const;
+    bool equals(const FieldView &oView) const;
+
+    FieldView mid(int nPos) const;
+    FieldView trimmed() const;
+
+    QString toString() const;
+};
+
+enum SeasonType {
+    SEASON_SPRING,
+    SEASON_SUMMER,
+    SEASON_FALL,
+    SEASON_WINTER,
+    SEASON_COUNT
+};
+
+// Fields of one "[|]" separated clip line. Views point into the line buffer
+// and are only valid while it is.
+struct ClipLineFields {
+    FieldView   showName;
+    int         epNum;
+    int         startMsecs;
+    int         endMsecs;
+    SeasonType  season;
+    int         year;
+    FieldView   tags;
+    FieldView   source;
+    FieldView   link;
+    FieldView   note;
+};
+
+// Tokenizer for the clip file format. Walks the bytes in place and never allocates.
+class ClipLineParser
+{
+public:
+    static const int NUM_FIELDS = 9;
+
+    static bool nextLine(const char *&rPos, const char *nEnd, FieldView &rLine);
+    static bool parse(FieldView nLine, ClipLineFields &rFields);
+    static bool nextTag(FieldView &rTags, FieldView &rTag);
+
+    static int parseInt(FieldView nField);
+    static int parseTime(FieldView nField);
+
+    static SeasonType parseSeason(FieldView nField);
+    static QString seasonName(SeasonType nSeason);
+
+    static bool isUtf8(const char *nData, qint64 nSize);
+    static QString decodeText(const QByteArray &nBytes);
+};
+
+#endif // CLIPPARSER_H
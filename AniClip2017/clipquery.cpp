@@ -0,0 +1,440 @@
+#include "clipquery.h"
+#include "clipstore.h"
+#include "clipparser.h"
+#include "stringpool.h"
+#include "postingindex.h"
+#include "intervalindex.h"
+
+#include <climits>
+
+ClipQueryParams::ClipQueryParams() :
+    showKey(),
+    epStartRange(0),
+    epEndRange(0),
+    seasonKey(0),
+    yearKey(0),
+    sStartTime(0, 0),
+    sEndtime(0, 0),
+    lengthLowBound(0),
+    lengthHighBound(0),
+    noteKey(),
+    keyTags(),
+    subTags()
+{
+
+}
+
+bool ClipQueryParams::isEmpty() const {
+    return  showKey.isEmpty()                   &&
+            epStartRange    == 0                &&
+            epEndRange      == 0                &&
+            seasonKey       == 0                &&
+            yearKey         == 0                &&
+            sStartTime      == QTime(0, 0)      &&
+            sEndtime        == QTime(0, 0)      &&
+            lengthLowBound  == 0                &&
+            lengthHighBound == 0                &&
+            noteKey.isEmpty()                   &&
+            keyTags.isEmpty()                   &&
+            subTags.isEmpty();
+}
+
+// True if every clip matching these parameters also matches oParams: the
+// text keys only grew and nothing else changed.
+bool ClipQueryParams::narrows(const ClipQueryParams &oParams) const {
+    return  showKey.contains(oParams.showKey, Qt::CaseInsensitive)  &&
+            noteKey.contains(oParams.noteKey, Qt::CaseInsensitive)  &&
+            epStartRange    == oParams.epStartRange                 &&
+            epEndRange      == oParams.epEndRange                   &&
+            seasonKey       == oParams.seasonKey                    &&
+            yearKey         == oParams.yearKey                      &&
+            sStartTime      == oParams.sStartTime                   &&
+            sEndtime        == oParams.sEndtime                     &&
+            lengthLowBound  == oParams.lengthLowBound               &&
+            lengthHighBound == oParams.lengthHighBound              &&
+            keyTags         == oParams.keyTags                      &&
+            subTags         == oParams.subTags;
+}
+
+static int boundMsecs(const QTime &nTime) {
+    int rMsecs = -1;
+    if (nTime.isValid() && nTime != QTime(0, 0)) {
+        rMsecs = nTime.msecsSinceStartOfDay();
+    }
+    return rMsecs;
+}
+
+ClipQuery::ClipQuery(const ClipStore *nStore, const ClipQueryParams &nParams) :
+    store(nStore),
+    cancel(NULL),
+    empty_flag(nParams.isEmpty()),
+    impossible_flag(false),
+    keyTagIds(),
+    subTagIds(),
+    showIds(),
+    showIdSet(),
+    showFilter_flag(false),
+    yearKey(0),
+    seasonId(-1),
+    epStart(0),
+    epEnd(0),
+    startMsecs(-1),
+    endMsecs(-1),
+    lengthLowMsecs(-1),
+    lengthHighMsecs(-1),
+    noteKey(),
+    source(SOURCE_SCAN),
+    sourceCost(0)
+{
+    compile(nParams);
+}
+
+void ClipQuery::compile(const ClipQueryParams &nParams) {
+    StringPool *pool = store->getStringPool();
+    const PostingIndex &tagIndex = store->getTagIndex();
+    const PostingIndex &showIndex = store->getShowIndex();
+
+    source = SOURCE_SCAN;
+    sourceCost = store->count();
+
+    // A key tag nobody has means nothing can match. Unknown sub tags are
+    // skipped unless all of them are unknown.
+    for (int i = 0; i < nParams.keyTags.count(); i++) {
+        int tagId = pool->find(nParams.keyTags.at(i));
+        if (tagId == -1) {
+            impossible_flag = true;
+        }
+        keyTagIds.append(tagId);
+    }
+    for (int i = 0; i < nParams.subTags.count(); i++) {
+        int tagId = pool->find(nParams.subTags.at(i));
+        if (tagId != -1) {
+            subTagIds.append(tagId);
+        }
+    }
+    if (!nParams.subTags.isEmpty() && subTagIds.isEmpty()) {
+        impossible_flag = true;
+    }
+
+    if (!keyTagIds.isEmpty() || !subTagIds.isEmpty()) {
+        int cost = 0;
+        if (!keyTagIds.isEmpty()) {
+            cost = tagIndex.count(keyTagIds.at(0));
+            for (int i = 1; i < keyTagIds.count(); i++) {
+                cost = qMin(cost, tagIndex.count(keyTagIds.at(i)));
+            }
+        }
+        else {
+            for (int i = 0; i < subTagIds.count(); i++) {
+                cost += tagIndex.count(subTagIds.at(i));
+            }
+        }
+
+        if (cost < sourceCost) {
+            source = SOURCE_TAGS;
+            sourceCost = cost;
+        }
+    }
+
+    if (!nParams.showKey.isEmpty()) {
+        showFilter_flag = true;
+        int cost = 0;
+
+        QList<int> shows = showIndex.keys();
+        for (int i = 0; i < shows.count(); i++) {
+            if (pool->string(shows.at(i)).contains(nParams.showKey, Qt::CaseInsensitive)) {
+                showIds.append(shows.at(i));
+                showIdSet.insert(shows.at(i));
+                cost += showIndex.count(shows.at(i));
+            }
+        }
+
+        if (showIds.isEmpty()) {
+            impossible_flag = true;
+        }
+        else if (cost < sourceCost) {
+            source = SOURCE_SHOW;
+            sourceCost = cost;
+        }
+    }
+
+    if (nParams.yearKey != 0) {
+        yearKey = nParams.yearKey;
+        int cost = store->getYearIndex().count(yearKey);
+
+        if (cost < sourceCost) {
+            source = SOURCE_YEAR;
+            sourceCost = cost;
+        }
+    }
+
+    if (nParams.seasonKey > 0 && nParams.seasonKey <= SEASON_COUNT) {
+        seasonId = pool->find(ClipLineParser::seasonName(SeasonType(nParams.seasonKey - 1)));
+
+        if (seasonId == -1) {
+            impossible_flag = true;
+        }
+        else if (store->getSeasonIndex().count(seasonId) < sourceCost) {
+            source = SOURCE_SEASON;
+            sourceCost = store->getSeasonIndex().count(seasonId);
+        }
+    }
+
+    epStart = nParams.epStartRange;
+    epEnd = nParams.epEndRange;
+    startMsecs = boundMsecs(nParams.sStartTime);
+    endMsecs = boundMsecs(nParams.sEndtime);
+    if (nParams.lengthLowBound > 0) {
+        lengthLowMsecs = nParams.lengthLowBound * 1000;
+    }
+    if (nParams.lengthHighBound > 0) {
+        lengthHighMsecs = nParams.lengthHighBound * 1000;
+    }
+    noteKey = nParams.noteKey;
+
+    const IntervalIndex &intervalIndex = store->getIntervalIndex();
+
+    // The episode index leaves out clips without valid times, so it may
+    // only drive a query that drops them anyway.
+    bool timeFilter_flag = startMsecs != -1 || endMsecs != -1 || lengthLowMsecs != -1 || lengthHighMsecs != -1;
+
+    if (showIds.count() == 1 && epStart > 0 && epStart == epEnd && timeFilter_flag) {
+        int cost = intervalIndex.episodeCount(showIds.at(0), epStart);
+        if (cost < sourceCost) {
+            source = SOURCE_EPISODE;
+            sourceCost = cost;
+        }
+    }
+
+    if (lengthLowMsecs != -1 || lengthHighMsecs != -1) {
+        int cost = intervalIndex.countByLength(lengthLowMsecs, lengthHighMsecs);
+        if (cost < sourceCost) {
+            source = SOURCE_LENGTH;
+            sourceCost = cost;
+        }
+    }
+}
+
+// While *nCancel is non zero, run() and filter() stop early and return a
+// partial result; check isCancelled() before using it.
+void ClipQuery::setCancelFlag(const QAtomicInt *nCancel) {
+    cancel = nCancel;
+}
+
+bool ClipQuery::isCancelled() const {
+    return cancel != NULL && cancel->load() != 0;
+}
+
+QVector<int> ClipQuery::candidates() const {
+    QVector<int> rIds;
+
+    switch (source) {
+    case SOURCE_TAGS:
+        if (!keyTagIds.isEmpty()) {
+            rIds = store->getTagIndex().matchAll(keyTagIds);
+        }
+        else {
+            rIds = store->getTagIndex().matchAny(subTagIds);
+        }
+        break;
+    case SOURCE_SHOW:
+        rIds = store->getShowIndex().matchAny(showIds);
+        break;
+    case SOURCE_YEAR:
+        rIds = store->getYearIndex().postings(yearKey);
+        break;
+    case SOURCE_SEASON:
+        rIds = store->getSeasonIndex().postings(seasonId);
+        break;
+    case SOURCE_EPISODE:
+        rIds = store->getIntervalIndex().within(showIds.at(0), epStart,
+                                                startMsecs == -1 ? 0 : startMsecs,
+                                                endMsecs == -1 ? INT_MAX : endMsecs);
+        break;
+    case SOURCE_LENGTH:
+        rIds = store->getIntervalIndex().byLength(lengthLowMsecs, lengthHighMsecs);
+        break;
+    case SOURCE_SCAN:
+        rIds.reserve(store->count());
+        for (int i = 0; i < store->count() && ((i & 0xfff) != 0 || !isCancelled()); i++) {
+            if (store->contains(i)) {
+                rIds.append(i);
+            }
+        }
+        break;
+    }
+
+    return rIds;
+}
+
+// Sorted ids of every live clip that matches.
+QVector<int> ClipQuery::run() const {
+    QVector<int> rIds;
+
+    if (!impossible_flag) {
+        QVector<int> cIds = candidates();
+
+        if (empty_flag) {
+            rIds = cIds;
+        }
+        else {
+            rIds.reserve(cIds.count());
+            for (int i = 0; i < cIds.count() && ((i & 0xfff) != 0 || !isCancelled()); i++) {
+                if (matchesClip(store->at(cIds.at(i)))) {
+                    rIds.append(cIds.at(i));
+                }
+            }
+        }
+    }
+
+    return rIds;
+}
+
+// Keeps the ids in nClipIds that match, in their order. Used to refine an
+// earlier result instead of going back to the indexes.
+QVector<int> ClipQuery::filter(const QVector<int> &nClipIds) const {
+    QVector<int> rIds;
+
+    if (!impossible_flag) {
+        rIds.reserve(nClipIds.count());
+        for (int i = 0; i < nClipIds.count() && ((i & 0xfff) != 0 || !isCancelled()); i++) {
+            if (matches(nClipIds.at(i))) {
+                rIds.append(nClipIds.at(i));
+            }
+        }
+    }
+
+    return rIds;
+}
+
+bool ClipQuery::matches(int nClipId) const {
+    bool rFlag = false;
+
+    if (!impossible_flag && store->contains(nClipId)) {
+        rFlag = empty_flag || matchesClip(store->at(nClipId));
+    }
+
+    return rFlag;
+}
+
+bool ClipQuery::matchesClip(const Clip &nClip) const {
+    bool rFlag = true;
+
+    for (int i = 0; i < keyTagIds.count() && rFlag; i++) {
+        rFlag = nClip.tagIds.contains(keyTagIds.at(i));
+    }
+
+    if (rFlag && !subTagIds.isEmpty()) {
+        rFlag = false;
+        for (int i = 0; i < subTagIds.count() && !rFlag; i++) {
+            rFlag = nClip.tagIds.contains(subTagIds.at(i));
+        }
+    }
+
+    if (rFlag && showFilter_flag) {
+        rFlag = showIdSet.contains(nClip.showId);
+    }
+    if (rFlag && yearKey != 0) {
+        rFlag = nClip.year == yearKey;
+    }
+    if (rFlag && seasonId != -1) {
+        rFlag = nClip.seasonId == seasonId;
+    }
+    if (rFlag && epStart > 0) {
+        rFlag = nClip.epNum >= epStart;
+    }
+    if (rFlag && epEnd > 0) {
+        rFlag = nClip.epNum <= epEnd;
+    }
+
+    if (rFlag && (startMsecs != -1 || endMsecs != -1 || lengthLowMsecs != -1 || lengthHighMsecs != -1)) {
+        int clipStart = timeToMsecs(nClip.bounds.startTime);
+        int clipEnd = timeToMsecs(nClip.bounds.endTime);
+
+        if (clipStart == -1 || clipEnd == -1) {
+            rFlag = false;
+        }
+        else {
+            int clipLength = clipEnd - clipStart;
+
+            rFlag = (startMsecs      == -1 || clipStart  >= startMsecs)      &&
+                    (endMsecs        == -1 || clipEnd    <= endMsecs)        &&
+                    (lengthLowMsecs  == -1 || clipLength >= lengthLowMsecs)  &&
+                    (lengthHighMsecs == -1 || clipLength <= lengthHighMsecs);
+        }
+    }
+
+    if (rFlag && !noteKey.isEmpty()) {
+        rFlag = nClip.note.contains(noteKey, Qt::CaseInsensitive);
+    }
+
+    return rFlag;
+}
+
+bool ClipQuery::isEmpty() const {
+    return empty_flag;
+}
+
+bool ClipQuery::isImpossible() const {
+    return impossible_flag;
+}
+
+QString ClipQuery::describe() const {
+    static const char *sourceNames[] = {"scan", "tags", "show", "year", "season", "episode", "length"};
+
+    QString rDescription;
+    if (impossible_flag) {
+        rDescription = "no possible matches";
+    }
+    else {
+        rDescription = QString("%1 index, %2 candidates").arg(sourceNames[source]).arg(sourceCost);
+    }
+    return rDescription;
+}
+
+ClipQueryResult::ClipQueryResult() :
+    query_flag(false),
+    matches(),
+    params(),
+    revision(-1),
+    plan()
+{
+
+}
+
+// Runs nParams against nStore. Returns false, leaving the result as it was,
+// if *nCancel was raised before the search finished.
+bool ClipQueryResult::update(const ClipStore *nStore, const ClipQueryParams &nParams, const QAtomicInt *nCancel) {
+    bool rFinished_flag = true;
+    ClipQuery query(nStore, nParams);
+    query.setCancelFlag(nCancel);
+
+    bool refine_flag = query_flag && revision == nStore->getRevision() && nParams.narrows(params);
+    QVector<int> nMatches;
+    QString nPlan;
+
+    if (query.isEmpty()) {
+        nPlan = "no filter";
+    }
+    else if (refine_flag) {
+        nMatches = query.filter(matches);
+        nPlan = QString("refined %1 matches").arg(matches.count());
+    }
+    else {
+        nMatches = query.run();
+        nPlan = query.describe();
+    }
+
+    if (query.isCancelled()) {
+        rFinished_flag = false;
+    }
+    else {
+        query_flag = !query.isEmpty();
+        matches = nMatches;
+        params = nParams;
+        revision = nStore->getRevision();
+        plan = nPlan;
+    }
+
+    return rFinished_flag;
+}
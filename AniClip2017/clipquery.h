@@ -0,0 +1,118 @@
+#ifndef CLIPQUERY_H
+#define CLIPQUERY_H
+
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <QSet>
+#include <QTime>
+#include <QAtomicInt>
+
+class ClipStore;
+struct Clip;
+
+// Search parameters of the clip tree. Zero, empty and 00:00:00 values mean
+// "any". seasonKey is a SeasonType plus one; lengths are in seconds.
+struct ClipQueryParams {
+    QString     showKey;
+    int         epStartRange;
+    int         epEndRange;
+
+    int         seasonKey;
+    int         yearKey;
+
+    QTime       sStartTime;
+    QTime       sEndtime;
+
+    int         lengthLowBound;
+    int         lengthHighBound;
+
+    QString     noteKey;
+
+    QStringList keyTags;
+    QStringList subTags;
+
+    ClipQueryParams();
+
+    bool isEmpty() const;
+    bool narrows(const ClipQueryParams &oParams) const;
+};
+
+// A ClipQueryParams resolved against a ClipStore. Names become pool ids and
+// every indexed constraint (tags, show, year, season, a single episode of a
+// single show, length) is costed by how many clips its index would return. run() starts from the cheapest of them and checks the
+// rest, plus the unindexed predicates, on the surviving clips only.
+class ClipQuery
+{
+public:
+    ClipQuery(const ClipStore *nStore, const ClipQueryParams &nParams);
+
+    void setCancelFlag(const QAtomicInt *nCancel);
+
+    QVector<int> run() const;
+    QVector<int> filter(const QVector<int> &nClipIds) const;
+    bool matches(int nClipId) const;
+
+    bool isEmpty() const;
+    bool isImpossible() const;
+    bool isCancelled() const;
+    QString describe() const;
+
+private:
+    enum Source {
+        SOURCE_SCAN,
+        SOURCE_TAGS,
+        SOURCE_SHOW,
+        SOURCE_YEAR,
+        SOURCE_SEASON,
+        SOURCE_EPISODE,
+        SOURCE_LENGTH
+    };
+
+    void compile(const ClipQueryParams &nParams);
+    QVector<int> candidates() const;
+    bool matchesClip(const Clip &nClip) const;
+
+    const ClipStore *store;
+    const QAtomicInt *cancel;
+
+    bool empty_flag;
+    bool impossible_flag;
+
+    // Indexed constraints. An empty id list means unconstrained.
+    QVector<int> keyTagIds;
+    QVector<int> subTagIds;
+    QVector<int> showIds;
+    QSet<int>    showIdSet;
+    bool         showFilter_flag;
+    int          yearKey;
+    int          seasonId;
+
+    // Checked per clip.
+    int          epStart;
+    int          epEnd;
+    int          startMsecs;
+    int          endMsecs;
+    int          lengthLowMsecs;
+    int          lengthHighMsecs;
+    QString      noteKey;
+
+    Source       source;
+    int          sourceCost;
+};
+
+// Outcome of the last search. A search that narrows it at the same store
+// revision only filters its matches instead of going back to the indexes.
+struct ClipQueryResult {
+    bool            query_flag;
+    QVector<int>    matches;
+    ClipQueryParams params;
+    int             revision;
+    QString         plan;
+
+    ClipQueryResult();
+
+    bool update(const ClipStore *nStore, const ClipQueryParams &nParams, const QAtomicInt *nCancel = NULL);
+};
+
+#endif // CLIPQUERY_H
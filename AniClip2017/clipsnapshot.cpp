@@ -0,0 +1,427 @@
+#include "clipsnapshot.h"
+#include "clipdatabase.h"
+#include "modelsnapshot.h"
+#include "stringpool.h"
+#include "logger.h"
+#include "tracer.h"
+
+#include <QFile>
+#include <QFileInfo>
+#include <QDateTime>
+#include <QByteArray>
+#include <QSet>
+
+static const quint32 SNAPSHOT_MAGIC   = 0x4E534341; // "ACSN"
+static const quint32 SNAPSHOT_VERSION = 1;
+
+Q_STATIC_ASSERT(sizeof(SnapshotHeader) == 48);
+Q_STATIC_ASSERT(sizeof(SnapshotClip) == 44);
+
+// Bounds checked walk over the mapped file.
+class SnapshotReader
+{
+public:
+    SnapshotReader(const uchar *nBase, qint64 nSize) :
+        base(nBase),
+        size(nSize),
+        pos(0)
+    {
+
+    }
+
+    const uchar* take(qint64 nBytes) {
+        const uchar *rPtr = NULL;
+        if (nBytes >= 0 && pos + nBytes <= size) {
+            rPtr = base + pos;
+            pos += nBytes;
+        }
+        return rPtr;
+    }
+
+    const quint32* takeU32(qint64 nCount) {
+        return reinterpret_cast<const quint32*>(take(nCount * sizeof(quint32)));
+    }
+
+private:
+    const uchar *base;
+    qint64 size;
+    qint64 pos;
+};
+
+static void appendU32(QByteArray &nData, quint32 nValue) {
+    nData.append(reinterpret_cast<const char*>(&nValue), sizeof(nValue));
+}
+
+// Pool id for a string of the snapshot table, interning it on first use.
+static int poolIdFor(StringPool *nPool, const QVector<QString> &nTable, QVector<int> &rPoolIds, quint32 nIndex) {
+    if (rPoolIds.at(nIndex) == -1) {
+        rPoolIds[nIndex] = nPool->intern(nTable.at(nIndex));
+    }
+    return rPoolIds.at(nIndex);
+}
+
+ClipSnapshot::ClipSnapshot(logger::Logger *nLog) :
+    log(nLog),
+    strings(),
+    stringIds(),
+    poolIds()
+{
+
+}
+
+QString ClipSnapshot::snapshotFilename(QString clipList_filename) {
+    return clipList_filename + ".snap";
+}
+
+quint32 ClipSnapshot::internString(const QString &nString) {
+    quint32 rId = 0;
+    QHash<QString, quint32>::const_iterator found = stringIds.constFind(nString);
+
+    if (found != stringIds.constEnd()) {
+        rId = found.value();
+    }
+    else {
+        rId = strings.count();
+        strings.append(nString);
+        stringIds.insert(nString, rId);
+    }
+
+    return rId;
+}
+
+// poolIds caches the snapshot id + 1 of each pooled string, 0 meaning not written yet.
+quint32 ClipSnapshot::internPoolId(const StringPool *nPool, int nPoolId) {
+    quint32 rId = 0;
+
+    if (nPoolId < 0 || nPoolId >= nPool->count()) {
+        rId = internString(QString());
+    }
+    else {
+        if (nPoolId >= poolIds.count()) {
+            poolIds.resize(nPool->count());
+        }
+
+        if (poolIds.at(nPoolId) == 0) {
+            poolIds[nPoolId] = internString(nPool->string(nPoolId)) + 1;
+        }
+
+        rId = poolIds.at(nPoolId) - 1;
+    }
+
+    return rId;
+}
+
+bool ClipSnapshot::write(const ModelSnapshot &nSnapshot, QString clipList_filename) {
+    logger::TraceSpan span("ClipSnapshot.write");
+    bool writeSuccess_flag = false;
+    QFileInfo sourceInfo(clipList_filename);
+
+    if (sourceInfo.exists()) {
+        strings.clear();
+        stringIds.clear();
+        poolIds.fill(0, nSnapshot.stringPool.count());
+
+        const StringPool *pool = &nSnapshot.stringPool;
+        const ClipStore *store = &nSnapshot.clipStore;
+        QHash<int, quint32> clipIds;
+        QVector<SnapshotClip> records;
+        QVector<quint32> tagRefs;
+
+        for (int i = 0; i < nSnapshot.mainList.shows.count(); i++) {
+            const ShowSnapshot *cShow = &nSnapshot.mainList.shows.at(i);
+
+            for (int j = 0; j < cShow->clips.count(); j++) {
+                const Clip *cClip = &store->at(cShow->clips.at(j));
+
+                SnapshotClip nRecord;
+                nRecord.showId      = internPoolId(pool, cClip->showId);
+                nRecord.epNum       = cClip->epNum;
+                nRecord.startMsecs  = timeToMsecs(cClip->bounds.startTime);
+                nRecord.endMsecs    = timeToMsecs(cClip->bounds.endTime);
+                nRecord.seasonId    = internPoolId(pool, cClip->seasonId);
+                nRecord.year        = cClip->year;
+                nRecord.tagStart    = tagRefs.count();
+                nRecord.tagCount    = cClip->tagIds.count();
+                nRecord.srcId       = internString(cClip->localSrc);
+                nRecord.linkId      = internString(cClip->link);
+                nRecord.noteId      = internString(cClip->note);
+
+                for (int t = 0; t < cClip->tagIds.count(); t++) {
+                    tagRefs.append(internPoolId(pool, cClip->tagIds.at(t)));
+                }
+
+                clipIds.insert(cShow->clips.at(j), records.count());
+                records.append(nRecord);
+            }
+        }
+
+        QByteArray listData;
+        for (int i = 0; i < nSnapshot.subLists.count(); i++) {
+            const ListSnapshot *cList = &nSnapshot.subLists.at(i);
+            QVector<quint32> members;
+
+            for (int j = 0; j < cList->shows.count(); j++) {
+                const ShowSnapshot *cShow = &cList->shows.at(j);
+                for (int k = 0; k < cShow->clips.count(); k++) {
+                    QHash<int, quint32>::const_iterator found = clipIds.constFind(cShow->clips.at(k));
+                    if (found != clipIds.constEnd()) {
+                        members.append(found.value());
+                    }
+                }
+            }
+
+            appendU32(listData, internPoolId(pool, cList->nameId));
+            appendU32(listData, members.count());
+            listData.append(reinterpret_cast<const char*>(members.constData()), members.count() * sizeof(quint32));
+        }
+
+        QByteArray stringBlob;
+        QVector<quint32> stringOffsets;
+        for (int i = 0; i < strings.count(); i++) {
+            stringOffsets.append(stringBlob.size());
+            stringBlob.append(strings.at(i).toUtf8());
+        }
+        stringOffsets.append(stringBlob.size());
+
+        SnapshotHeader header;
+        header.magic            = SNAPSHOT_MAGIC;
+        header.version          = SNAPSHOT_VERSION;
+        header.sourceSize       = sourceInfo.size();
+        header.sourceModified   = sourceInfo.lastModified().toMSecsSinceEpoch();
+        header.stringCount      = strings.count();
+        header.stringBytes      = stringBlob.size();
+        header.clipCount        = records.count();
+        header.tagRefCount      = tagRefs.count();
+        header.listCount        = nSnapshot.subLists.count();
+        header.reserved         = 0;
+
+        while (stringBlob.size() % 4 != 0) {
+            stringBlob.append('\0');
+        }
+
+        QByteArray data;
+        data.append(reinterpret_cast<const char*>(&header), sizeof(header));
+        data.append(reinterpret_cast<const char*>(stringOffsets.constData()), stringOffsets.count() * sizeof(quint32));
+        data.append(stringBlob);
+        data.append(reinterpret_cast<const char*>(records.constData()), records.count() * sizeof(SnapshotClip));
+        data.append(reinterpret_cast<const char*>(tagRefs.constData()), tagRefs.count() * sizeof(quint32));
+        data.append(listData);
+
+        QFile snapFile(snapshotFilename(clipList_filename));
+        if (snapFile.open(QIODevice::WriteOnly)) {
+            if (snapFile.write(data) == data.size()) {
+                writeSuccess_flag = true;
+                log->info(QString("Wrote snapshot \"%1\" (%2 clips, %3 strings).").arg(snapFile.fileName()).arg(records.count()).arg(strings.count()));
+            }
+            else {
+                log->err(QString("QFile::%1").arg(snapFile.errorString()));
+            }
+            snapFile.close();
+        }
+        else {
+            log->err(QString("Unable to open snapshot \"%1\" for writing.").arg(snapFile.fileName()));
+        }
+
+        strings.clear();
+        stringIds.clear();
+        poolIds.clear();
+    }
+    else {
+        log->warn(QString("ClipSnapshot.write: Source file \"%1\" does not exist.").arg(clipList_filename));
+    }
+
+    return writeSuccess_flag;
+}
+
+bool ClipSnapshot::load(ClipDatabase *db, QString clipList_filename) {
+    logger::TraceSpan span("ClipSnapshot.load");
+    bool loadSuccess_flag = false;
+
+    QFileInfo sourceInfo(clipList_filename);
+    QFile snapFile(snapshotFilename(clipList_filename));
+
+    if (!sourceInfo.exists() || !snapFile.exists()) {
+        log->info(QString("No snapshot for \"%1\".").arg(clipList_filename));
+    }
+    else if (!snapFile.open(QIODevice::ReadOnly)) {
+        log->warn(QString("Unable to open snapshot \"%1\".").arg(snapFile.fileName()));
+    }
+    else {
+        qint64 fileSize = snapFile.size();
+        uchar *base = snapFile.map(0, fileSize);
+
+        if (base == NULL) {
+            log->warn(QString("Unable to map snapshot \"%1\".").arg(snapFile.fileName()));
+        }
+        else {
+            SnapshotReader reader(base, fileSize);
+            const SnapshotHeader *header = reinterpret_cast<const SnapshotHeader*>(reader.take(sizeof(SnapshotHeader)));
+
+            bool valid_flag = (header != NULL && header->magic == SNAPSHOT_MAGIC && header->version == SNAPSHOT_VERSION);
+
+            if (!valid_flag) {
+                log->warn(QString("Snapshot \"%1\" has an unknown format.").arg(snapFile.fileName()));
+            }
+            else if (header->sourceSize != sourceInfo.size() ||
+                     header->sourceModified != sourceInfo.lastModified().toMSecsSinceEpoch()) {
+                log->info(QString("Snapshot \"%1\" is stale.").arg(snapFile.fileName()));
+                valid_flag = false;
+            }
+
+            const quint32 *stringOffsets = NULL;
+            const char *stringBlob = NULL;
+            const SnapshotClip *records = NULL;
+            const quint32 *tagRefs = NULL;
+
+            if (valid_flag) {
+                quint32 paddedBytes = (header->stringBytes + 3) & ~3u;
+
+                stringOffsets   = reader.takeU32(qint64(header->stringCount) + 1);
+                stringBlob      = reinterpret_cast<const char*>(reader.take(paddedBytes));
+                records         = reinterpret_cast<const SnapshotClip*>(reader.take(qint64(header->clipCount) * sizeof(SnapshotClip)));
+                tagRefs         = reader.takeU32(header->tagRefCount);
+
+                valid_flag = (stringOffsets != NULL && stringBlob != NULL && records != NULL && tagRefs != NULL);
+            }
+
+            // Validate every reference before touching the database.
+            QVector<QString> table;
+            if (valid_flag) {
+                table.reserve(header->stringCount);
+                for (quint32 i = 0; i < header->stringCount && valid_flag; i++) {
+                    quint32 start = stringOffsets[i];
+                    quint32 end = stringOffsets[i + 1];
+                    if (start <= end && end <= header->stringBytes) {
+                        table.append(QString::fromUtf8(stringBlob + start, end - start));
+                    }
+                    else {
+                        valid_flag = false;
+                    }
+                }
+
+                for (quint32 i = 0; i < header->clipCount && valid_flag; i++) {
+                    const SnapshotClip &cRecord = records[i];
+                    if (cRecord.showId >= header->stringCount || cRecord.seasonId >= header->stringCount ||
+                        cRecord.srcId  >= header->stringCount || cRecord.linkId   >= header->stringCount ||
+                        cRecord.noteId >= header->stringCount ||
+                        qint64(cRecord.tagStart) + cRecord.tagCount > header->tagRefCount) {
+                        valid_flag = false;
+                    }
+                }
+
+                for (quint32 i = 0; i < header->tagRefCount && valid_flag; i++) {
+                    if (tagRefs[i] >= header->stringCount) {
+                        valid_flag = false;
+                    }
+                }
+            }
+
+            QVector<QString> listNames;
+            QVector<const quint32*> listMembers;
+            QVector<quint32> listCounts;
+            for (quint32 i = 0; valid_flag && i < header->listCount; i++) {
+                const quint32 *listHeader = reader.takeU32(2);
+                const quint32 *members = (listHeader != NULL) ? reader.takeU32(listHeader[1]) : NULL;
+
+                if (members != NULL && listHeader[0] < header->stringCount) {
+                    for (quint32 j = 0; j < listHeader[1] && valid_flag; j++) {
+                        if (members[j] >= header->clipCount) {
+                            valid_flag = false;
+                        }
+                    }
+                    listNames.append(table.at(listHeader[0]));
+                    listMembers.append(members);
+                    listCounts.append(listHeader[1]);
+                }
+                else {
+                    valid_flag = false;
+                }
+            }
+
+            if (!valid_flag && header != NULL && header->magic == SNAPSHOT_MAGIC) {
+                log->warn(QString("Snapshot \"%1\" is not usable.").arg(snapFile.fileName()));
+            }
+
+            if (valid_flag) {
+                StringPool *pool = db->getStringPool();
+                QVector<int> tablePoolIds(header->stringCount, -1);
+                ClipStore *store = db->getClipStore();
+                QVector<int> nClips(header->clipCount, -1);
+                QSet<int> seenShows;
+                QSet<quint32> usedTags;
+                QStringList nTags;
+
+                store->reserve(store->count() + header->clipCount);
+
+                for (quint32 i = 0; i < header->clipCount; i++) {
+                    const SnapshotClip &cRecord = records[i];
+                    Clip nClip;
+
+                    nClip.showId            = poolIdFor(pool, table, tablePoolIds, cRecord.showId);
+                    nClip.epNum             = cRecord.epNum;
+                    nClip.bounds.startTime  = msecsToTime(cRecord.startMsecs);
+                    nClip.bounds.endTime    = msecsToTime(cRecord.endMsecs);
+                    nClip.seasonId          = poolIdFor(pool, table, tablePoolIds, cRecord.seasonId);
+                    nClip.year              = cRecord.year;
+                    nClip.localSrc          = table.at(cRecord.srcId);
+                    nClip.link              = table.at(cRecord.linkId);
+                    nClip.note              = table.at(cRecord.noteId);
+
+                    nClip.tagIds.reserve(cRecord.tagCount);
+                    for (quint32 t = cRecord.tagStart; t < cRecord.tagStart + cRecord.tagCount; t++) {
+                        nClip.tagIds.append(poolIdFor(pool, table, tablePoolIds, tagRefs[t]));
+                        if (!usedTags.contains(tagRefs[t])) {
+                            usedTags.insert(tagRefs[t]);
+                            nTags.append(table.at(tagRefs[t]));
+                        }
+                    }
+
+                    if (!seenShows.contains(nClip.showId)) {
+                        seenShows.insert(nClip.showId);
+                        db->addExistingShow(table.at(cRecord.showId));
+                    }
+
+                    if (store->findClip(nClip.getKey()) == -1) {
+                        int nClipId = store->addClip(nClip);
+                        db->main_list->addClip(nClipId);
+                        nClips[i] = nClipId;
+                    }
+                }
+
+                db->getTagManager()->addTags(nTags);
+
+                for (int i = 0; i < listNames.count(); i++) {
+                    ClipList *cList = NULL;
+                    for (int j = 0; j < db->sub_lists.count() && cList == NULL; j++) {
+                        if (db->sub_lists.at(j)->getName() == listNames.at(i)) {
+                            cList = db->sub_lists.at(j);
+                        }
+                    }
+
+                    if (cList == NULL) {
+                        cList = new ClipList(log, store);
+                        cList->setName(listNames.at(i));
+                        cList->setBulkInsert(db->isBulkLoad());
+                        db->sub_lists.append(cList);
+                    }
+
+                    for (quint32 j = 0; j < listCounts.at(i); j++) {
+                        int cClipId = nClips.at(listMembers.at(i)[j]);
+                        if (cClipId != -1) {
+                            cList->addClip(cClipId);
+                        }
+                    }
+                }
+
+                log->info(QString("Loaded %1 clips and %2 lists from snapshot \"%3\".").arg(header->clipCount).arg(header->listCount).arg(snapFile.fileName()));
+                loadSuccess_flag = true;
+            }
+
+            snapFile.unmap(base);
+        }
+
+        snapFile.close();
+    }
+
+    return loadSuccess_flag;
+}
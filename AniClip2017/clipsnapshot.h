@@ -0,0 +1,80 @@
+#ifndef CLIPSNAPSHOT_H
+#define CLIPSNAPSHOT_H
+
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <QHash>
+
+namespace logger {
+class Logger;
+}
+
+class ClipDatabase;
+class ModelSnapshot;
+class StringPool;
+
+// Binary copy of the clip file. Written next to the text file on save and
+// memory mapped on startup. Layout (all fields native endian, 4 byte aligned):
+//
+//  SnapshotHeader
+//  quint32[stringCount + 1]    string offsets into the string blob
+//  char[]                      UTF-8 string blob, padded to 4 bytes
+//  SnapshotClip[clipCount]     fixed width clip records
+//  quint32[tagRefCount]        string ids referenced by SnapshotClip::tagStart
+//  per sub list: quint32 nameId, quint32 count, quint32 clipIndex[count]
+//
+// Clip records are in main list order, so main list membership is implicit.
+//
+// The header stores the size and modification time of the text file it was
+// built from. If those no longer match, the snapshot is stale and ignored.
+
+struct SnapshotHeader {
+    quint32 magic;
+    quint32 version;
+    qint64  sourceSize;
+    qint64  sourceModified;
+    quint32 stringCount;
+    quint32 stringBytes;
+    quint32 clipCount;
+    quint32 tagRefCount;
+    quint32 listCount;
+    quint32 reserved;
+};
+
+struct SnapshotClip {
+    quint32 showId;
+    qint32  epNum;
+    qint32  startMsecs;
+    qint32  endMsecs;
+    quint32 seasonId;
+    qint32  year;
+    quint32 tagStart;
+    quint32 tagCount;
+    quint32 srcId;
+    quint32 linkId;
+    quint32 noteId;
+};
+
+class ClipSnapshot
+{
+public:
+    explicit ClipSnapshot(logger::Logger *nLog);
+
+    static QString snapshotFilename(QString clipList_filename);
+
+    bool write(const ModelSnapshot &nSnapshot, QString clipList_filename);
+    bool load(ClipDatabase *db, QString clipList_filename);
+
+private:
+    quint32 internString(const QString &nString);
+    quint32 internPoolId(const StringPool *nPool, int nPoolId);
+
+    logger::Logger *log;
+
+    QStringList             strings;
+    QHash<QString, quint32> stringIds;
+    QVector<qint32>         poolIds;
+};
+
+#endif // CLIPSNAPSHOT_H
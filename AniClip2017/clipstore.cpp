@@ -0,0 +1,306 @@
+#include "clipstore.h"
+#include "stringpool.h"
+
+int timeToMsecs(const QTime &nTime) {
+    int rMsecs = -1;
+    if (nTime.isValid()) {
+        rMsecs = nTime.msecsSinceStartOfDay();
+    }
+    return rMsecs;
+}
+
+QTime msecsToTime(int nMsecs) {
+    QTime rTime;
+    if (nMsecs >= 0) {
+        rTime = QTime::fromMSecsSinceStartOfDay(nMsecs);
+    }
+    return rTime;
+}
+
+ClipKey::ClipKey() :
+    showId(-1),
+    epNum(0),
+    startMsecs(-1),
+    endMsecs(-1)
+{
+
+}
+
+ClipKey::ClipKey(int nShowId, int nEpNum, TimeBound nTime) :
+    showId(nShowId),
+    epNum(nEpNum),
+    startMsecs(timeToMsecs(nTime.startTime)),
+    endMsecs(timeToMsecs(nTime.endTime))
+{
+
+}
+
+bool ClipKey::operator==(const ClipKey &oKey) const {
+    return  showId     == oKey.showId     &&
+            epNum      == oKey.epNum      &&
+            startMsecs == oKey.startMsecs &&
+            endMsecs   == oKey.endMsecs;
+}
+
+uint qHash(const ClipKey &key, uint seed) {
+    uint rHash = qHash(key.showId, seed);
+    rHash = (rHash * 31) ^ qHash(key.epNum);
+    rHash = (rHash * 31) ^ qHash(key.startMsecs);
+    rHash = (rHash * 31) ^ qHash(key.endMsecs);
+    return rHash;
+}
+
+Clip::Clip() :
+    showId(-1),
+    epNum(0),
+    bounds(),
+    seasonId(-1),
+    year(0),
+    tagIds(),
+    localSrc(),
+    link(),
+    note()
+{
+
+}
+
+ClipKey Clip::getKey() const {
+    return ClipKey(showId, epNum, bounds);
+}
+
+bool Clip::compareClip(const Clip &oClip) const {
+    return getKey() == oClip.getKey();
+}
+
+ClipStore::ClipStore(StringPool *nPool) :
+    stringPool(nPool),
+    clips(),
+    clipIndex(),
+    revision(0),
+    tagIndex(),
+    showIndex(),
+    yearIndex(),
+    seasonIndex(),
+    intervalIndex()
+{
+
+}
+
+// Copies for saving leave the value indexes behind; nothing queries them.
+// Search copies keep them. Everything is implicitly shared, so either way
+// the copy is cheap until the original changes.
+ClipStore::ClipStore(const ClipStore &oStore, StringPool *nPool, bool nIndexes_flag) :
+    stringPool(nPool),
+    clips(oStore.clips),
+    clipIndex(oStore.clipIndex),
+    revision(oStore.revision),
+    tagIndex(),
+    showIndex(),
+    yearIndex(),
+    seasonIndex(),
+    intervalIndex()
+{
+    if (nIndexes_flag) {
+        tagIndex = oStore.tagIndex;
+        showIndex = oStore.showIndex;
+        yearIndex = oStore.yearIndex;
+        seasonIndex = oStore.seasonIndex;
+        intervalIndex = oStore.intervalIndex;
+    }
+}
+
+int ClipStore::addClip(const Clip &nClip) {
+    ClipKey nKey = nClip.getKey();
+    int rId = clipIndex.value(nKey, -1);
+
+    if (rId == -1) {
+        rId = clips.count();
+        clips.append(nClip);
+        clipIndex.insert(nKey, rId);
+        revision++;
+        tagIndex.addClip(rId, nClip.tagIds);
+        showIndex.addClip(rId, nClip.showId);
+        yearIndex.addClip(rId, nClip.year);
+        seasonIndex.addClip(rId, nClip.seasonId);
+        intervalIndex.addClip(rId, nClip);
+    }
+
+    return rId;
+}
+
+bool ClipStore::removeClip(int nId) {
+    bool rFlag = false;
+
+    if (contains(nId)) {
+        clipIndex.remove(clips.at(nId).getKey());
+        revision++;
+        tagIndex.removeClip(nId, clips.at(nId).tagIds);
+        showIndex.removeClip(nId, clips.at(nId).showId);
+        yearIndex.removeClip(nId, clips.at(nId).year);
+        seasonIndex.removeClip(nId, clips.at(nId).seasonId);
+        intervalIndex.removeClip(nId, clips.at(nId));
+        rFlag = true;
+    }
+
+    return rFlag;
+}
+
+// Tags have to change through here so the tag index follows. Ids that are
+// not stored, including removed clips, are ignored.
+void ClipStore::setTags(int nId, const QVector<int> &nTagIds) {
+    if (contains(nId) && clips.at(nId).tagIds != nTagIds) {
+        Clip &rClip = clips[nId];
+
+        revision++;
+        tagIndex.removeClip(nId, rClip.tagIds);
+        tagIndex.addClip(nId, nTagIds);
+        rClip.tagIds = nTagIds;
+    }
+}
+
+void ClipStore::setSeason(int nId, int nSeasonId) {
+    if (contains(nId) && clips.at(nId).seasonId != nSeasonId) {
+        Clip &rClip = clips[nId];
+
+        revision++;
+        seasonIndex.removeClip(nId, rClip.seasonId);
+        seasonIndex.addClip(nId, nSeasonId);
+        rClip.seasonId = nSeasonId;
+    }
+}
+
+void ClipStore::setYear(int nId, int nYear) {
+    if (contains(nId) && clips.at(nId).year != nYear) {
+        Clip &rClip = clips[nId];
+
+        revision++;
+        yearIndex.removeClip(nId, rClip.year);
+        yearIndex.addClip(nId, nYear);
+        rClip.year = nYear;
+    }
+}
+
+void ClipStore::setSource(int nId, const QString &nSource) {
+    if (contains(nId) && clips.at(nId).localSrc != nSource) {
+        revision++;
+        clips[nId].localSrc = nSource;
+    }
+}
+
+void ClipStore::setLink(int nId, const QString &nLink) {
+    if (contains(nId) && clips.at(nId).link != nLink) {
+        revision++;
+        clips[nId].link = nLink;
+    }
+}
+
+void ClipStore::setNote(int nId, const QString &nNote) {
+    if (contains(nId) && clips.at(nId).note != nNote) {
+        revision++;
+        clips[nId].note = nNote;
+    }
+}
+
+int ClipStore::findClip(const ClipKey &nKey) const {
+    return clipIndex.value(nKey, -1);
+}
+
+bool ClipStore::contains(int nId) const {
+    return nId >= 0 && nId < clips.count() && clipIndex.value(clips.at(nId).getKey(), -1) == nId;
+}
+
+void ClipStore::reserve(int nCount) {
+    clips.reserve(nCount);
+    clipIndex.reserve(nCount);
+}
+
+// See IntervalIndex::setBulkLoad.
+void ClipStore::setBulkLoad(bool nBulk) {
+    intervalIndex.setBulkLoad(nBulk);
+}
+
+int ClipStore::count() const {
+    return clips.count();
+}
+
+// Bumped by every change a query could see.
+int ClipStore::getRevision() const {
+    return revision;
+}
+
+const Clip& ClipStore::at(int nId) const {
+    return clips.at(nId);
+}
+
+
+QString ClipStore::getShowName(int nId) const {
+    return stringPool->string(clips.at(nId).showId);
+}
+
+QString ClipStore::getSeason(int nId) const {
+    return stringPool->string(clips.at(nId).seasonId);
+}
+
+QStringList ClipStore::getTags(int nId) const {
+    return stringPool->strings(clips.at(nId).tagIds);
+}
+
+QString ClipStore::clipLine(int nId) const {
+    const Clip &cClip = clips.at(nId);
+    QString rLine;
+
+    QTextStream lineStream(&rLine);
+    lineStream << getShowName(nId) << "[|]" << cClip.epNum << "[|]" << cClip.bounds.startTime.toString("hh:mm:ss") << "-" << cClip.bounds.endTime.toString("hh:mm:ss") << "[|]";
+    lineStream << getSeason(nId) << "[|]" << cClip.year << "[|]" << getTags(nId).join("|") << "[|]" << cClip.localSrc << "[|]" << cClip.link << "[|]" << cClip.note;
+    lineStream.flush();
+
+    return rLine;
+}
+
+void ClipStore::writeClipToFile(QTextStream &nStream, int nId) const {
+    nStream << clipLine(nId) << endl;
+}
+
+StringPool* ClipStore::getStringPool() const {
+    return stringPool;
+}
+
+const PostingIndex &ClipStore::getTagIndex() const {
+    return tagIndex;
+}
+
+const PostingIndex &ClipStore::getShowIndex() const {
+    return showIndex;
+}
+
+const PostingIndex &ClipStore::getYearIndex() const {
+    return yearIndex;
+}
+
+const PostingIndex &ClipStore::getSeasonIndex() const {
+    return seasonIndex;
+}
+
+const IntervalIndex &ClipStore::getIntervalIndex() const {
+    return intervalIndex;
+}
+
+qint64 ClipStore::memoryUsage() const {
+    qint64 rBytes = clips.capacity() * sizeof(Clip);
+
+    for (int i = 0; i < clips.count(); i++) {
+        const Clip &cClip = clips.at(i);
+        rBytes += cClip.tagIds.capacity() * sizeof(int);
+        rBytes += (cClip.localSrc.capacity() + cClip.link.capacity() + cClip.note.capacity()) * sizeof(QChar);
+    }
+
+    rBytes += clipIndex.count() * (sizeof(void*) + sizeof(uint) + sizeof(ClipKey) + sizeof(int));
+    rBytes += clipIndex.capacity() * sizeof(void*);
+    rBytes += tagIndex.memoryUsage();
+    rBytes += showIndex.memoryUsage();
+    rBytes += yearIndex.memoryUsage();
+    rBytes += seasonIndex.memoryUsage();
+    rBytes += intervalIndex.memoryUsage();
+
+    return rBytes;
+}
@@ -0,0 +1,116 @@
+#ifndef CLIPSTORE_H
+#define CLIPSTORE_H
+
+#include <QVector>
+#include <QHash>
+#include <QTime>
+#include <QStringList>
+#include <QTextStream>
+
+#include "postingindex.h"
+#include "intervalindex.h"
+
+class StringPool;
+
+struct TimeBound {
+    QTime startTime;
+    QTime endTime;
+};
+
+// Identity of a clip. Two clips with the same show, episode and bounds are the same clip.
+struct ClipKey {
+    int     showId;
+    int     epNum;
+    int     startMsecs;
+    int     endMsecs;
+
+    ClipKey();
+    ClipKey(int nShowId, int nEpNum, TimeBound nTime);
+
+    bool operator==(const ClipKey &oKey) const;
+};
+
+uint qHash(const ClipKey &key, uint seed = 0);
+
+int   timeToMsecs(const QTime &nTime);
+QTime msecsToTime(int nMsecs);
+
+// One clip. Plain value record; strings that repeat across clips are StringPool ids.
+struct Clip {
+    int          showId;
+    int          epNum;
+    TimeBound    bounds;
+    int          seasonId;
+    int          year;
+    QVector<int> tagIds;
+    QString      localSrc;
+    QString      link;
+    QString      note;
+
+    Clip();
+
+    ClipKey getKey() const;
+    bool compareClip(const Clip &oClip) const;
+};
+
+Q_DECLARE_TYPEINFO(Clip, Q_MOVABLE_TYPE);
+
+// Contiguous storage for every clip in the database. A clip id is its index
+// in the store and stays valid for the life of the store. Removed clips keep
+// their slot but are dropped from the identity index. Tags, show, year and
+// season are also indexed by value, and time bounds by interval; season,
+// year and tags of a stored clip must change through the setters so the
+// indexes follow.
+class ClipStore
+{
+public:
+    explicit ClipStore(StringPool *nPool);
+    ClipStore(const ClipStore &oStore, StringPool *nPool, bool nIndexes_flag = false);
+
+    int addClip(const Clip &nClip);
+    bool removeClip(int nId);
+    void setTags(int nId, const QVector<int> &nTagIds);
+    void setSeason(int nId, int nSeasonId);
+    void setYear(int nId, int nYear);
+    void setSource(int nId, const QString &nSource);
+    void setLink(int nId, const QString &nLink);
+    void setNote(int nId, const QString &nNote);
+    int findClip(const ClipKey &nKey) const;
+    bool contains(int nId) const;
+    void reserve(int nCount);
+    void setBulkLoad(bool nBulk);
+
+    int count() const;
+    int getRevision() const;
+    const Clip& at(int nId) const;
+
+    QString getShowName(int nId) const;
+    QString getSeason(int nId) const;
+    QStringList getTags(int nId) const;
+
+    QString clipLine(int nId) const;
+    void writeClipToFile(QTextStream &nStream, int nId) const;
+
+    StringPool* getStringPool() const;
+    const PostingIndex &getTagIndex() const;
+    const PostingIndex &getShowIndex() const;
+    const PostingIndex &getYearIndex() const;
+    const PostingIndex &getSeasonIndex() const;
+    const IntervalIndex &getIntervalIndex() const;
+    qint64 memoryUsage() const;
+
+private:
+    StringPool *stringPool;
+
+    QVector<Clip>       clips;
+    QHash<ClipKey, int> clipIndex;
+    int                 revision;
+
+    PostingIndex        tagIndex;
+    PostingIndex        showIndex;
+    PostingIndex        yearIndex;
+    PostingIndex        seasonIndex;
+    IntervalIndex       intervalIndex;
+};
+
+#endif // CLIPSTORE_H
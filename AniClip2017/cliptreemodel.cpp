@@ -0,0 +1,401 @@
+#include "cliptreemodel.h"
+#include "clipdatabase.h"
+#include "stringpool.h"
+#include "rowdiff.h"
+#include "tracer.h"
+
+#include <QBitArray>
+
+ClipTreeModel::ClipTreeModel(QObject *parent) : QAbstractItemModel(parent),
+    clipDB(NULL),
+    lists(),
+    numClips(0)
+{
+
+}
+
+ClipTreeModel::~ClipTreeModel() {
+    for (int i = 0; i < lists.count(); i++) {
+        deleteNode(lists.at(i));
+    }
+}
+
+void ClipTreeModel::setClipDatabase(ClipDatabase *db) {
+    beginResetModel();
+    clipDB = db;
+    for (int i = 0; i < lists.count(); i++) {
+        deleteNode(lists.at(i));
+    }
+    lists.clear();
+    numClips = 0;
+    endResetModel();
+}
+
+void ClipTreeModel::deleteNode(Node *nNode) {
+    if (nNode != NULL) {
+        for (int i = 0; i < nNode->children.count(); i++) {
+            deleteNode(nNode->children.at(i));
+        }
+        delete nNode;
+    }
+}
+
+void ClipTreeModel::renumber(QVector<Node*> &rNodes) {
+    for (int i = 0; i < rNodes.count(); i++) {
+        rNodes.at(i)->row = i;
+    }
+}
+
+// nMatches, when given, holds the sorted ids of the clips to list.
+void ClipTreeModel::refresh(const QVector<ClipList*> &nLists, const QString &nShowKey, const QVector<int> *nMatches) {
+    logger::TraceSpan span("ClipTreeModel.refresh");
+    QBitArray matched;
+    if (nMatches != NULL && !nMatches->isEmpty()) {
+        matched.resize(nMatches->last() + 1);
+        for (int i = 0; i < nMatches->count(); i++) {
+            matched.setBit(nMatches->at(i));
+        }
+    }
+
+    // Build the wanted tree detached from the view, then fold it into the
+    // current one.
+    QVector<Node*> target;
+    numClips = 0;
+
+    for (int i = 0; i < nLists.count(); i++) {
+        ClipList *cList = nLists.at(i);
+        Node *nList = new Node;
+        nList->parent = NULL;
+        nList->key = cList->listNameId;
+        nList->row = target.count();
+
+        for (int j = 0; j < cList->shows.count(); j++) {
+            ShowList *cShow = cList->shows.at(j);
+
+            if (nShowKey.isEmpty() || cShow->getName().contains(nShowKey, Qt::CaseInsensitive)) {
+                QVector<int> nClips;
+
+                if (nMatches == NULL) {
+                    nClips = cShow->clips;
+                }
+                else {
+                    for (int k = 0; k < cShow->clips.count(); k++) {
+                        int cClipId = cShow->clips.at(k);
+                        if (cClipId < matched.size() && matched.testBit(cClipId)) {
+                            nClips.append(cClipId);
+                        }
+                    }
+                }
+
+                if (!nClips.isEmpty()) {
+                    Node *nShow = new Node;
+                    nShow->parent = nList;
+                    nShow->key = cShow->getShowId();
+                    nShow->row = nList->children.count();
+                    nShow->clips = nClips;
+                    nList->children.append(nShow);
+                    numClips += nClips.count();
+                }
+            }
+        }
+
+        target.append(nList);
+    }
+
+    syncChildren(NULL, lists, target);
+
+    for (int i = 0; i < target.count(); i++) {
+        deleteNode(target.at(i));
+    }
+}
+
+// Makes rChildren (the rows under nParent) match rTarget. Nodes for new rows
+// are moved over from rTarget and their slot there set to NULL; the rest stay
+// owned by the caller.
+void ClipTreeModel::syncChildren(Node *nParent, QVector<Node*> &rChildren, QVector<Node*> &rTarget) {
+    QModelIndex parentIndex = nodeIndex(nParent);
+
+    QVector<int> oldKeys;
+    QVector<int> newKeys;
+    oldKeys.reserve(rChildren.count());
+    newKeys.reserve(rTarget.count());
+    for (int i = 0; i < rChildren.count(); i++) {
+        oldKeys.append(rChildren.at(i)->key);
+    }
+    for (int i = 0; i < rTarget.count(); i++) {
+        newKeys.append(rTarget.at(i)->key);
+    }
+
+    RowDiff diff = diffRows(oldKeys, newKeys);
+
+    if (diff.reordered_flag) {
+        if (!rChildren.isEmpty()) {
+            beginRemoveRows(parentIndex, 0, rChildren.count() - 1);
+            for (int i = 0; i < rChildren.count(); i++) {
+                deleteNode(rChildren.at(i));
+            }
+            rChildren.clear();
+            endRemoveRows();
+        }
+
+        diff.removed.clear();
+        diff.inserted.clear();
+        if (!rTarget.isEmpty()) {
+            RowRange all;
+            all.first = 0;
+            all.last = rTarget.count() - 1;
+            diff.inserted.append(all);
+        }
+    }
+
+    for (int i = 0; i < diff.removed.count(); i++) {
+        const RowRange &cRange = diff.removed.at(i);
+
+        beginRemoveRows(parentIndex, cRange.first, cRange.last);
+        for (int r = cRange.first; r <= cRange.last; r++) {
+            deleteNode(rChildren.at(r));
+        }
+        rChildren.remove(cRange.first, cRange.last - cRange.first + 1);
+        renumber(rChildren);
+        endRemoveRows();
+    }
+
+    QVector<bool> inserted(rTarget.count(), false);
+    for (int i = 0; i < diff.inserted.count(); i++) {
+        const RowRange &cRange = diff.inserted.at(i);
+
+        beginInsertRows(parentIndex, cRange.first, cRange.last);
+        for (int r = cRange.first; r <= cRange.last; r++) {
+            Node *nNode = rTarget.at(r);
+            nNode->parent = nParent;
+            for (int c = 0; c < nNode->children.count(); c++) {
+                nNode->children.at(c)->parent = nNode;
+            }
+            rChildren.insert(r, nNode);
+            inserted[r] = true;
+        }
+        renumber(rChildren);
+        endInsertRows();
+    }
+
+    // Rows that were already there: fold in their own children or clips.
+    for (int i = 0; i < rTarget.count(); i++) {
+        if (!inserted.at(i)) {
+            Node *cNode = rChildren.at(i);
+
+            if (nParent == NULL) {
+                syncChildren(cNode, cNode->children, rTarget.at(i)->children);
+            }
+            else {
+                syncClips(cNode, rTarget.at(i)->clips);
+            }
+
+            QModelIndex cIndex = nodeIndex(cNode);
+            emit dataChanged(cIndex, cIndex);
+        }
+    }
+
+    for (int i = 0; i < rTarget.count(); i++) {
+        if (inserted.at(i)) {
+            rTarget[i] = NULL;
+        }
+    }
+}
+
+void ClipTreeModel::syncClips(Node *nShow, const QVector<int> &nClips) {
+    QModelIndex showIndex = nodeIndex(nShow);
+    RowDiff diff = diffRows(nShow->clips, nClips);
+
+    if (diff.reordered_flag) {
+        if (!nShow->clips.isEmpty()) {
+            beginRemoveRows(showIndex, 0, nShow->clips.count() - 1);
+            nShow->clips.clear();
+            endRemoveRows();
+        }
+        if (!nClips.isEmpty()) {
+            beginInsertRows(showIndex, 0, nClips.count() - 1);
+            nShow->clips = nClips;
+            endInsertRows();
+        }
+    }
+    else {
+        for (int i = 0; i < diff.removed.count(); i++) {
+            const RowRange &cRange = diff.removed.at(i);
+            beginRemoveRows(showIndex, cRange.first, cRange.last);
+            nShow->clips.remove(cRange.first, cRange.last - cRange.first + 1);
+            endRemoveRows();
+        }
+
+        for (int i = 0; i < diff.inserted.count(); i++) {
+            const RowRange &cRange = diff.inserted.at(i);
+            beginInsertRows(showIndex, cRange.first, cRange.last);
+            for (int r = cRange.first; r <= cRange.last; r++) {
+                nShow->clips.insert(r, nClips.at(r));
+            }
+            endInsertRows();
+        }
+
+        // Clip text may have changed through an edit.
+        if (!nShow->clips.isEmpty()) {
+            emit dataChanged(index(0, 0, showIndex), index(nShow->clips.count() - 1, COLUMN_COUNT - 1, showIndex));
+        }
+    }
+}
+
+QModelIndex ClipTreeModel::nodeIndex(Node *nNode) const {
+    QModelIndex rIndex;
+    if (nNode != NULL) {
+        rIndex = createIndex(nNode->row, 0, nNode->parent);
+    }
+    return rIndex;
+}
+
+// Node a list or show index stands for.
+ClipTreeModel::Node *ClipTreeModel::nodeAt(const QModelIndex &nIndex) const {
+    Node *rNode = NULL;
+
+    if (nIndex.isValid()) {
+        Node *cParent = static_cast<Node*>(nIndex.internalPointer());
+        if (cParent == NULL) {
+            rNode = lists.at(nIndex.row());
+        }
+        else if (cParent->parent == NULL) {
+            rNode = cParent->children.at(nIndex.row());
+        }
+    }
+
+    return rNode;
+}
+
+int ClipTreeModel::clipId(const QModelIndex &nIndex) const {
+    int rClipId = -1;
+
+    if (nIndex.isValid()) {
+        Node *cParent = static_cast<Node*>(nIndex.internalPointer());
+        if (cParent != NULL && cParent->parent != NULL) {
+            rClipId = cParent->clips.at(nIndex.row());
+        }
+    }
+
+    return rClipId;
+}
+
+int ClipTreeModel::getClipCount() const {
+    return numClips;
+}
+
+QModelIndex ClipTreeModel::index(int row, int column, const QModelIndex &parent) const {
+    QModelIndex rIndex;
+
+    if (row >= 0 && column >= 0 && column < COLUMN_COUNT) {
+        if (!parent.isValid()) {
+            if (row < lists.count()) {
+                rIndex = createIndex(row, column, static_cast<void*>(NULL));
+            }
+        }
+        else {
+            Node *cNode = nodeAt(parent);
+            if (cNode != NULL && row < qMax(cNode->children.count(), cNode->clips.count())) {
+                rIndex = createIndex(row, column, cNode);
+            }
+        }
+    }
+
+    return rIndex;
+}
+
+QModelIndex ClipTreeModel::parent(const QModelIndex &child) const {
+    QModelIndex rIndex;
+
+    if (child.isValid()) {
+        rIndex = nodeIndex(static_cast<Node*>(child.internalPointer()));
+    }
+
+    return rIndex;
+}
+
+int ClipTreeModel::rowCount(const QModelIndex &parent) const {
+    int rCount = 0;
+
+    if (!parent.isValid()) {
+        rCount = lists.count();
+    }
+    else if (parent.column() == 0) {
+        Node *cNode = nodeAt(parent);
+        if (cNode != NULL) {
+            rCount = qMax(cNode->children.count(), cNode->clips.count());
+        }
+    }
+
+    return rCount;
+}
+
+int ClipTreeModel::columnCount(const QModelIndex &/*parent*/) const {
+    return COLUMN_COUNT;
+}
+
+QVariant ClipTreeModel::data(const QModelIndex &index, int role) const {
+    QVariant rData;
+
+    if (index.isValid() && role == Qt::DisplayRole && clipDB != NULL) {
+        StringPool *pool = clipDB->getStringPool();
+        Node *cNode = nodeAt(index);
+
+        if (cNode == NULL) {
+            rData = clipText(clipId(index), index.column());
+        }
+        else if (index.column() == COLUMN_SHOW) {
+            if (cNode->parent == NULL) {
+                rData = QString("%1 (%2 Shows)").arg(pool->string(cNode->key)).arg(cNode->children.count());
+            }
+            else {
+                rData = QString("%1 (%2 Clips)").arg(pool->string(cNode->key)).arg(cNode->clips.count());
+            }
+        }
+    }
+
+    return rData;
+}
+
+QString ClipTreeModel::clipText(int nClipId, int nColumn) const {
+    ClipStore *store = clipDB->getClipStore();
+    const Clip &cClip = store->at(nClipId);
+    QString rText;
+
+    switch (nColumn) {
+    case COLUMN_SHOW:
+        rText = store->getShowName(nClipId);
+        break;
+    case COLUMN_EPISODE:
+        rText = QString::number(cClip.epNum);
+        break;
+    case COLUMN_BOUNDS:
+        rText = QString("%1-%2").arg(cClip.bounds.startTime.toString("hh:mm:ss")).arg(cClip.bounds.endTime.toString("hh:mm:ss"));
+        break;
+    case COLUMN_SEASON:
+        rText = QString("%1 %2").arg(store->getSeason(nClipId)).arg(cClip.year);
+        break;
+    case COLUMN_TAGS:
+        rText = store->getTags(nClipId).join("; ");
+        break;
+    case COLUMN_LINK:
+        rText = cClip.link;
+        break;
+    case COLUMN_NOTE:
+        rText = cClip.note;
+        break;
+    }
+
+    return rText;
+}
+
+QVariant ClipTreeModel::headerData(int section, Qt::Orientation orientation, int role) const {
+    static const char *headers[COLUMN_COUNT] = {"Show", "Episode", "Bounds", "Season", "Tags", "Link", "Note"};
+    QVariant rData;
+
+    if (orientation == Qt::Horizontal && role == Qt::DisplayRole && section >= 0 && section < COLUMN_COUNT) {
+        rData = QString(headers[section]);
+    }
+
+    return rData;
+}
@@ -0,0 +1,76 @@
+#ifndef CLIPTREEMODEL_H
+#define CLIPTREEMODEL_H
+
+#include <QAbstractItemModel>
+#include <QVector>
+
+class ClipDatabase;
+class ClipList;
+
+// List > show > clip tree over the ClipStore. A refresh only records the
+// clip ids that pass the current filter; nothing is formatted until the
+// view asks for a row, which with uniform row heights means visible rows.
+//
+// A refresh is applied as a change set against the rows the view already
+// has: lists, shows and clips that are still there keep their rows, and
+// only the rows that appeared or went away are announced.
+class ClipTreeModel : public QAbstractItemModel
+{
+    Q_OBJECT
+public:
+    enum Column {
+        COLUMN_SHOW,
+        COLUMN_EPISODE,
+        COLUMN_BOUNDS,
+        COLUMN_SEASON,
+        COLUMN_TAGS,
+        COLUMN_LINK,
+        COLUMN_NOTE,
+        COLUMN_COUNT
+    };
+
+    explicit ClipTreeModel(QObject *parent = 0);
+    ~ClipTreeModel();
+
+    void setClipDatabase(ClipDatabase *db);
+    void refresh(const QVector<ClipList*> &nLists, const QString &nShowKey, const QVector<int> *nMatches);
+
+    int clipId(const QModelIndex &nIndex) const;
+    int getClipCount() const;
+
+    QModelIndex index(int row, int column, const QModelIndex &parent = QModelIndex()) const;
+    QModelIndex parent(const QModelIndex &child) const;
+    int rowCount(const QModelIndex &parent = QModelIndex()) const;
+    int columnCount(const QModelIndex &parent = QModelIndex()) const;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const;
+    QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const;
+
+private:
+    // A list (key is its name id, children are shows) or a show (key is the
+    // show id, clips are its rows). Indexes point at their parent node, so
+    // lists carry NULL, shows their list and clips their show.
+    struct Node {
+        Node            *parent;
+        int             key;
+        int             row;
+        QVector<Node*>  children;
+        QVector<int>    clips;
+    };
+
+    QModelIndex nodeIndex(Node *nNode) const;
+    Node *nodeAt(const QModelIndex &nIndex) const;
+
+    void syncChildren(Node *nParent, QVector<Node*> &rChildren, QVector<Node*> &rTarget);
+    void syncClips(Node *nShow, const QVector<int> &nClips);
+    static void renumber(QVector<Node*> &rNodes);
+    static void deleteNode(Node *nNode);
+
+    QString clipText(int nClipId, int nColumn) const;
+
+    ClipDatabase *clipDB;
+
+    QVector<Node*> lists;
+    int numClips;
+};
+
+#endif // CLIPTREEMODEL_H
@@ -1,20 +1,30 @@
 #include "cliptreewidget.h"
+#include "cliptreemodel.h"
 #include "logger.h"
 #include "clipdatabase.h"
+#include "postingindex.h"
+#include "tracer.h"
 
 #include <QElapsedTimer>
 #include <QDebug>
 #include <QHeaderView>
 
-ClipTreeWidget::ClipTreeWidget(QWidget *parent) : QTreeWidget(parent),
+ClipTreeWidget::ClipTreeWidget(QWidget *parent) : QTreeView(parent),
     clipDB(NULL),
-    log(NULL)
+    log(NULL),
+    clipModel(NULL),
+    params(),
+    result()
 {
+    clipModel = new ClipTreeModel(this);
+    setModel(clipModel);
+    setUniformRowHeights(true);
 }
 
 void ClipTreeWidget::setClipDatabase(ClipDatabase *db) {
     if (db != NULL) {
         clipDB = db;
+        clipModel->setClipDatabase(db);
     }
 }
 
@@ -24,101 +34,113 @@ void ClipTreeWidget::setLogger(logger::Logger *nLog) {
 
 void ClipTreeWidget::clearSearchParams() {
 
-    showKey.clear();
-    epStartRange = 0;
-    epEndRange = 0;
-    seasonKey = 0;
-    yearKey = 0;
+    params = ClipQueryParams();
 
-    sStartTime.setHMS(0,0,0,0);
-    sEndtime.setHMS(0,0,0,0);
+    header()->setSectionResizeMode(0, QHeaderView::ResizeToContents);
+    header()->setSectionResizeMode(4, QHeaderView::ResizeToContents);
+}
 
-    lengthLowBound = 0;
-    lengthHighBound = 0;
+const ClipQueryParams &ClipTreeWidget::getSearchParams() const {
+    return params;
+}
 
-    noteKey.clear();
+bool ClipTreeWidget::clipIsValid(int nClipId) {
+    bool rFlag = true;
 
-    keyTags.clear();
-    subTags.clear();
+    if (result.query_flag) {
+        rFlag = PostingIndex::containsId(result.matches, nClipId);
+    }
 
-    setColumnCount(9);
-    header()->setSectionResizeMode(0, QHeaderView::ResizeToContents);
-    header()->setSectionResizeMode(4, QHeaderView::ResizeToContents);
+    return rFlag;
 }
 
-bool ClipTreeWidget::clipIsValid(Clip *nClip) {
-    return true;
+void ClipTreeWidget::runQuery() {
+    logger::TraceSpan span("ClipTreeWidget.runQuery");
+    QElapsedTimer nTimer;
+    nTimer.start();
+
+    result.update(clipDB->getClipStore(), params);
+
+    if (result.query_flag) {
+        log->trace("ClipTreeWidget.runQuery: %1 matches from %2 in %3 ms", result.matches.count(), result.plan, nTimer.elapsed());
+    }
 }
 
-void ClipTreeWidget::updateTreeItem(QTreeWidgetItem *nItem, Clip *nClip) {
-    nItem->setText(0, nClip->showName);
-    nItem->setText(1, QString::number(nClip->epNum));
-    nItem->setText(2, QString("Bounds"));
-    nItem->setText(3, QString("Season %1").arg(nClip->year));
-    nItem->setText(4, nClip->tags.join("; "));
-    nItem->setText(5, QString("Link"));
-    nItem->setText(6, nClip->note);
+// Id of the clip under the cursor, or -1 if it is on a list or show row.
+int ClipTreeWidget::selectedClip() {
+    return clipModel->clipId(currentIndex());
 }
 
 void ClipTreeWidget::setShowKey(QString nShow) {
-    showKey = nShow;
+    params.showKey = nShow;
 }
 
 void ClipTreeWidget::setEpStartRange(int nStart) {
-    epStartRange = nStart;
+    params.epStartRange = nStart;
 }
 
 void ClipTreeWidget::setEpEndRange(int nEnd) {
-    epEndRange = nEnd;
+    params.epEndRange = nEnd;
 }
 
 void ClipTreeWidget::setSeason(int nSeason) {
-    seasonKey = nSeason;
+    params.seasonKey = nSeason;
 }
 
 void ClipTreeWidget::setYearKey(int nYear) {
-    yearKey = nYear;
+    params.yearKey = nYear;
 }
 
 void ClipTreeWidget::setStartTime(QString nStart) {
-    sStartTime.fromString(nStart);
+    params.sStartTime = QTime::fromString(nStart);
 }
 
 void ClipTreeWidget::setEndtime(QString nEnd) {
-    sEndtime.fromString(nEnd);
+    params.sEndtime = QTime::fromString(nEnd);
 }
 
 void ClipTreeWidget::setLengthLowBound(int nLow) {
-   lengthLowBound = nLow;
+   params.lengthLowBound = nLow;
 }
 
 void ClipTreeWidget::setLengthHighBound(int nHigh) {
-    lengthHighBound = nHigh;
+    params.lengthHighBound = nHigh;
 }
 
 void ClipTreeWidget::setNoteKey(QString nKey) {
-    noteKey = nKey;
+    params.noteKey = nKey;
 }
 
 void ClipTreeWidget::addKeyTag(QString nTag) {
-    keyTags.append(nTag);
+    params.keyTags.append(nTag);
 }
 
 void ClipTreeWidget::setKeyTags(QStringList nTags) {
-    keyTags.clear();
-    keyTags.append(nTags);
+    params.keyTags = nTags;
 }
 
 void ClipTreeWidget::addSubTag(QString nTag) {
-    subTags.append(nTag);
+    params.subTags.append(nTag);
 }
 
 void ClipTreeWidget::setSubTags(QStringList nTags) {
-    subTags.clear();
-    subTags.append(nTags);
+    params.subTags = nTags;
+}
+
+// Searches on the GUI thread. Typed searches go through SearchCoordinator
+// and arrive at showResult instead.
+void ClipTreeWidget::updateClips(const QString &/*searchString*/) {
+    runQuery();
+    refreshModel();
 }
 
-void ClipTreeWidget::updateClips(const QString &searchString) {
+void ClipTreeWidget::showResult(const ClipQueryResult &nResult) {
+    result = nResult;
+    refreshModel();
+}
+
+void ClipTreeWidget::refreshModel() {
+    logger::TraceSpan span("ClipTreeWidget.refreshModel");
     QElapsedTimer nTimer;
     nTimer.start();
 
@@ -135,95 +157,11 @@ void ClipTreeWidget::updateClips(const QString &searchString) {
         }
     }
 
-    int numLists = 0;
-
-    for (int i = 0; i < listsToShow.count(); i++) {
-        int numTopItems = topLevelItemCount();
-        QTreeWidgetItem* nItem = NULL;
-        if (i >= numTopItems) {
-            nItem = new QTreeWidgetItem(this);
-            addTopLevelItem(nItem);
-        }
-        else{
-            nItem = topLevelItem(i);
-        }
-
-        numLists++;
-        nItem->setHidden(false);
-
-        int numShows = 0;
-
-        for (int j = 0; j < listsToShow.at(i)->shows.count(); j++) {
-            ShowList* cShow = listsToShow.at(i)->shows.at(j);
-            bool addShow_flag = false;
-            int numClips = 0;
-
-            if (cShow->getName().contains(showKey, Qt::CaseInsensitive)) {
-                QTreeWidgetItem *nShow = NULL;
-                if (j >= nItem->childCount()) {
-                    nShow = new QTreeWidgetItem();
-                    nItem->addChild(nShow);
-                }
-                else {
-                    nShow = nItem->child(j);
-                }
-
-                for (int k = 0; k < cShow->clips.count(); k++) {
-                    Clip* cClip = cShow->clips.at(k);
-
-                    if (clipIsValid(cClip)) {
-
-                        QTreeWidgetItem *nClip = NULL;
-                        if (k >= nShow->childCount()) {
-                            nClip = new QTreeWidgetItem();
-                            nShow->addChild(nClip);
-                        }
-                        else {
-                            nClip = nShow->child(k);
-                        }
-
-                        if (nClip != NULL) {
-                            updateTreeItem(nClip, cClip);
-                            nShow->setHidden(false);
-                            addShow_flag = true;
-                            numClips++;
-                        }
-
-                    }
-                    else {
-                        nShow->child(k)->setHidden(true);
-                    }
-                }
-
-                if (addShow_flag) {
-                    numShows++;
-                    nShow->setHidden(false);
-                    nShow->setText(0, QString("%1 (%2 Clips)").arg(cShow->getName()).arg(numClips));
-
-                    if (numClips < nShow->childCount()) {
-                        for (int t = numClips; t < nShow->childCount(); t++) {
-                            nShow->child(t)->setHidden(true);
-                        }
-                    }
-                }
-                else {
-                    nShow->setHidden(true);
-                }
-            }
-        }
-
-        nItem->setText(0, QString("%1 (%2 Shows)").arg(listsToShow.at(i)->getName()).arg(numShows));
-        nItem->setHidden(false);
-
-        for (int t = numShows; t < nItem->childCount(); t++) {
-            nItem->child(t)->setHidden(true);
-        }
-    }
-
-    for (int t = numLists; t < topLevelItemCount(); t++) {
-        topLevelItem(t)->setHidden(true);
-    }
+    clipModel->refresh(listsToShow, result.params.showKey, result.query_flag ? &result.matches : NULL);
 
-    expandAll();
+    // Expanding every show would lay out every clip row, so only the lists
+    // are opened.
+    expandToDepth(0);
 
+    log->trace("ClipTreeWidget.refreshModel: %1 clips listed in %2 ms", clipModel->getClipCount(), nTimer.elapsed());
 }
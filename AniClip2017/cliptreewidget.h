@@ -2,17 +2,21 @@
 #define CLIPTREEWIDGET_H
 
 #include <QWidget>
-#include <QTreeWidget>
+#include <QTreeView>
 #include <QTime>
 
+#include "clipquery.h"
+
 class ClipDatabase;
-class Clip;
+class ClipTreeModel;
 
 namespace logger {
 class Logger;
 }
 
-class ClipTreeWidget : public QTreeWidget
+// Clip browser. Rows come from a ClipTreeModel, so a refresh costs one int
+// per listed clip and text is only built for rows on screen.
+class ClipTreeWidget : public QTreeView
 {
     Q_OBJECT
 public:
@@ -22,9 +26,9 @@ public:
     void setLogger(logger::Logger *nLog);
 
     void clearSearchParams();
-    bool clipIsValid(Clip* nClip);
-
-    void updateTreeItem(QTreeWidgetItem* nItem, Clip* nClip);
+    const ClipQueryParams &getSearchParams() const;
+    bool clipIsValid(int nClipId);
+    int selectedClip();
 
     void setShowKey(QString nShow);
     void setEpStartRange(int nStart);
@@ -51,27 +55,20 @@ private:
     ClipDatabase *clipDB;
     logger::Logger *log;
 
-    QString showKey;
-    int epStartRange;
-    int epEndRange;
-
-    int seasonKey;
-    int yearKey;
-
-    QTime sStartTime;
-    QTime sEndtime;
-
-    int lengthLowBound;
-    int lengthHighBound;
+    ClipTreeModel *clipModel;
+    ClipQueryParams params;
 
-    QString noteKey;
+    // Matches of the last search, sorted by id. Only used when
+    // result.query_flag is set.
+    ClipQueryResult result;
 
-    QStringList keyTags;
-    QStringList subTags;
+    void runQuery();
+    void refreshModel();
 signals:
 
 public slots:
     void updateClips(const QString &searchString);
+    void showResult(const ClipQueryResult &nResult);
 };
 
 #endif // CLIPTREEWIDGET_H
@@ -2,17 +2,43 @@
 #include "ui_debugwidget.h"
 
 #include "logger.h"
+#include "perfstats.h"
 #include "clipdatabase.h"
+#include "stringpool.h"
 
 #include <QFileDialog>
+#include <QTimer>
+#include <QTreeWidgetItem>
 
 DebugWidget::DebugWidget(logger::Logger* nLog, ClipDatabase *db, QWidget *parent) :
     QWidget(parent),
     ui(new Ui::DebugWidget),
     log(nLog),
-    clipDB(db)
+    clipDB(db),
+    refreshTimer(NULL),
+    metricItems(),
+    numTicks(0),
+    lastMessageCount(0),
+    rateTimer()
 {
     ui->setupUi(this);
+
+    static const char *names[METRIC_COUNT] = {
+        "Clips", "Shows", "Tags", "Clip store memory", "String pool memory",
+        "Load", "Save", "Backup", "Search latency", "Search worker",
+        "Clip tree refresh", "Tag tree refresh", "Log messages/s", "Log messages dropped"
+    };
+
+    for (int i = 0; i < METRIC_COUNT; i++) {
+        QTreeWidgetItem *nItem = new QTreeWidgetItem(ui->metricsTree);
+        nItem->setText(0, names[i]);
+        metricItems.append(nItem);
+    }
+    ui->metricsTree->resizeColumnToContents(0);
+
+    refreshTimer = new QTimer(this);
+    refreshTimer->setInterval(1000);
+    connect(refreshTimer, SIGNAL(timeout()), this, SLOT(updateMetrics()));
 }
 
 DebugWidget::~DebugWidget()
@@ -33,3 +59,82 @@ void DebugWidget::on_pushButton_clicked()
             }
         }
 }
+
+void DebugWidget::showEvent(QShowEvent *event) {
+    QWidget::showEvent(event);
+
+    numTicks = 0;
+    lastMessageCount = log->getMessageCount();
+    rateTimer.start();
+    updateMetrics();
+    refreshTimer->start();
+}
+
+void DebugWidget::hideEvent(QHideEvent *event) {
+    refreshTimer->stop();
+    QWidget::hideEvent(event);
+}
+
+// Everything here is a counter read or a copy of at most a few hundred
+// samples. Memory use walks every clip, so it is only redone every fifth tick.
+void DebugWidget::updateMetrics() {
+    ClipStore *store = clipDB->getClipStore();
+    StringPool *pool = clipDB->getStringPool();
+    TagManager *tagManager = clipDB->getTagManager();
+
+    int numTags = 0;
+    int generalId = pool->find("General");
+    for (int i = 0; i < tagManager->groups.count(); i++) {
+        if (tagManager->groups.at(i)->getNameId() == generalId) {
+            numTags = tagManager->groups.at(i)->getTagCount();
+        }
+    }
+
+    setMetric(METRIC_CLIPS, QString::number(clipDB->main_list->getClipCount()));
+    setMetric(METRIC_SHOWS, QString::number(clipDB->existingShows.count()));
+    setMetric(METRIC_TAGS, QString("%1 in %2 groups").arg(numTags).arg(tagManager->groups.count()));
+
+    if (numTicks % 5 == 0) {
+        setMetric(METRIC_STORE_MEMORY, QString("%1 KB").arg(store->memoryUsage() / 1024));
+        setMetric(METRIC_POOL_MEMORY, QString("%1 KB (%2 strings)").arg(pool->memoryUsage() / 1024).arg(pool->count()));
+    }
+
+    setMetric(METRIC_LOAD, spanText("ClipDatabase.init"));
+    setMetric(METRIC_SAVE, spanText("SaveThread.writeSnapshot"));
+    setMetric(METRIC_BACKUP, spanText("BackupStore.backup"));
+    setMetric(METRIC_SEARCH_LATENCY, spanText("SearchCoordinator.latency"));
+    setMetric(METRIC_SEARCH_WORKER, spanText("SearchThread.search"));
+    setMetric(METRIC_CLIP_REFRESH, spanText("ClipTreeWidget.refreshModel"));
+    setMetric(METRIC_TAG_REFRESH, spanText("TagTreeWidget.showResult"));
+
+    uint messageCount = log->getMessageCount();
+    qint64 elapsedMsecs = qMax(rateTimer.restart(), qint64(1));
+    setMetric(METRIC_LOG_RATE, QString::number((messageCount - lastMessageCount) * 1000.0 / elapsedMsecs, 'f', 1));
+    setMetric(METRIC_LOG_DROPPED, QString::number(log->getDroppedCount()));
+    lastMessageCount = messageCount;
+
+    numTicks++;
+}
+
+void DebugWidget::setMetric(Metric nMetric, const QString &nValue) {
+    QTreeWidgetItem *cItem = metricItems.at(nMetric);
+    if (cItem->text(1) != nValue) {
+        cItem->setText(1, nValue);
+    }
+}
+
+QString DebugWidget::spanText(const char *nName) {
+    logger::PerfStats::Summary cSummary = logger::PerfStats::summary(nName);
+    QString rText = "-";
+
+    if (cSummary.count > 0) {
+        rText = QString("last %1 ms, p50 %2, p90 %3, p99 %4 (%5 runs)")
+                    .arg(cSummary.lastNsecs / 1000000.0, 0, 'f', 1)
+                    .arg(cSummary.p50Nsecs / 1000000.0, 0, 'f', 1)
+                    .arg(cSummary.p90Nsecs / 1000000.0, 0, 'f', 1)
+                    .arg(cSummary.p99Nsecs / 1000000.0, 0, 'f', 1)
+                    .arg(cSummary.count);
+    }
+
+    return rText;
+}
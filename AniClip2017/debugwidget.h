@@ -2,12 +2,16 @@
 #define DEBUGWIDGET_H
 
 #include <QWidget>
+#include <QElapsedTimer>
+#include <QVector>
 
 namespace logger {
 class Logger;
 }
 
 class ClipDatabase;
+class QTimer;
+class QTreeWidgetItem;
 
 namespace Ui {
 class DebugWidget;
@@ -21,14 +25,48 @@ public:
     explicit DebugWidget(logger::Logger* nLog, ClipDatabase* db, QWidget *parent = 0);
     ~DebugWidget();
 
+protected:
+    void showEvent(QShowEvent *event);
+    void hideEvent(QHideEvent *event);
+
 private slots:
     void on_pushButton_clicked();
+    void updateMetrics();
 
 private:
+    enum Metric {
+        METRIC_CLIPS,
+        METRIC_SHOWS,
+        METRIC_TAGS,
+        METRIC_STORE_MEMORY,
+        METRIC_POOL_MEMORY,
+        METRIC_LOAD,
+        METRIC_SAVE,
+        METRIC_BACKUP,
+        METRIC_SEARCH_LATENCY,
+        METRIC_SEARCH_WORKER,
+        METRIC_CLIP_REFRESH,
+        METRIC_TAG_REFRESH,
+        METRIC_LOG_RATE,
+        METRIC_LOG_DROPPED,
+        METRIC_COUNT
+    };
+
+    void setMetric(Metric nMetric, const QString &nValue);
+    static QString spanText(const char *nName);
+
     Ui::DebugWidget *ui;
 
     logger::Logger *log;
     ClipDatabase *clipDB;
+
+    // Refreshes once a second while the widget is visible.
+    QTimer *refreshTimer;
+    QVector<QTreeWidgetItem*> metricItems;
+    int numTicks;
+
+    uint lastMessageCount;
+    QElapsedTimer rateTimer;
 };
 
 #endif // DEBUGWIDGET_H
@@ -0,0 +1,286 @@
+#include "intervalindex.h"
+#include "clipstore.h"
+
+#include <QtAlgorithms>
+
+bool IntervalIndex::Interval::operator<(const Interval &oInterval) const {
+    bool rFlag = false;
+
+    if (startMsecs != oInterval.startMsecs) {
+        rFlag = startMsecs < oInterval.startMsecs;
+    }
+    else if (endMsecs != oInterval.endMsecs) {
+        rFlag = endMsecs < oInterval.endMsecs;
+    }
+    else {
+        rFlag = clipId < oInterval.clipId;
+    }
+
+    return rFlag;
+}
+
+IntervalIndex::IntervalIndex() :
+    episodes(),
+    lengths(),
+    bulk_flag(false),
+    bulkEpisodes()
+{
+
+}
+
+quint64 IntervalIndex::episodeKey(int nShowId, int nEpNum) {
+    return (quint64(quint32(nShowId)) << 32) | quint32(nEpNum);
+}
+
+void IntervalIndex::addClip(int nClipId, const Clip &nClip) {
+    Interval nInterval;
+    nInterval.startMsecs = timeToMsecs(nClip.bounds.startTime);
+    nInterval.endMsecs = timeToMsecs(nClip.bounds.endTime);
+    nInterval.clipId = nClipId;
+    nInterval.maxEndMsecs = nInterval.endMsecs;
+
+    if (nInterval.startMsecs != -1 && nInterval.endMsecs != -1) {
+        quint64 key = episodeKey(nClip.showId, nClip.epNum);
+        Episode &cEpisode = episodes[key];
+
+        if (bulk_flag) {
+            cEpisode.intervals.append(nInterval);
+            bulkEpisodes.insert(key);
+        }
+        else {
+            QVector<Interval>::iterator found = qUpperBound(cEpisode.intervals.begin(), cEpisode.intervals.end(), nInterval);
+            cEpisode.intervals.insert(found, nInterval);
+            buildMaxEnds(cEpisode.intervals, 0, cEpisode.intervals.count());
+        }
+
+        QVector<int> &cLength = lengths[nInterval.endMsecs - nInterval.startMsecs];
+        if (cLength.isEmpty() || cLength.last() < nClipId) {
+            cLength.append(nClipId);
+        }
+        else {
+            cLength.insert(qLowerBound(cLength.begin(), cLength.end(), nClipId), nClipId);
+        }
+    }
+}
+
+void IntervalIndex::removeClip(int nClipId, const Clip &nClip) {
+    Interval nInterval;
+    nInterval.startMsecs = timeToMsecs(nClip.bounds.startTime);
+    nInterval.endMsecs = timeToMsecs(nClip.bounds.endTime);
+    nInterval.clipId = nClipId;
+    nInterval.maxEndMsecs = nInterval.endMsecs;
+
+    if (nInterval.startMsecs != -1 && nInterval.endMsecs != -1) {
+        quint64 key = episodeKey(nClip.showId, nClip.epNum);
+        QHash<quint64, Episode>::iterator cEpisode = episodes.find(key);
+        if (cEpisode != episodes.end()) {
+            if (bulkEpisodes.contains(key)) {
+                for (int i = 0; i < cEpisode->intervals.count(); i++) {
+                    if (cEpisode->intervals.at(i).clipId == nClipId) {
+                        cEpisode->intervals.remove(i);
+                        break;
+                    }
+                }
+            }
+            else {
+                QVector<Interval>::iterator found = qBinaryFind(cEpisode->intervals.begin(), cEpisode->intervals.end(), nInterval);
+                if (found != cEpisode->intervals.end()) {
+                    cEpisode->intervals.erase(found);
+                    buildMaxEnds(cEpisode->intervals, 0, cEpisode->intervals.count());
+                }
+            }
+            if (cEpisode->intervals.isEmpty()) {
+                episodes.erase(cEpisode);
+                bulkEpisodes.remove(key);
+            }
+        }
+
+        QMap<int, QVector<int> >::iterator cLength = lengths.find(nInterval.endMsecs - nInterval.startMsecs);
+        if (cLength != lengths.end()) {
+            QVector<int>::iterator found = qBinaryFind(cLength->begin(), cLength->end(), nClipId);
+            if (found != cLength->end()) {
+                cLength->erase(found);
+            }
+            if (cLength->isEmpty()) {
+                lengths.erase(cLength);
+            }
+        }
+    }
+}
+
+void IntervalIndex::clear() {
+    episodes.clear();
+    lengths.clear();
+    bulkEpisodes.clear();
+}
+
+// Turning bulk mode off sorts and rebuilds every episode added to since it
+// was turned on.
+void IntervalIndex::setBulkLoad(bool nBulk) {
+    bulk_flag = nBulk;
+
+    if (!bulk_flag) {
+        QSet<quint64>::const_iterator cKey = bulkEpisodes.constBegin();
+        for (; cKey != bulkEpisodes.constEnd(); ++cKey) {
+            QHash<quint64, Episode>::iterator cEpisode = episodes.find(*cKey);
+            if (cEpisode != episodes.end()) {
+                qSort(cEpisode->intervals);
+                buildMaxEnds(cEpisode->intervals, 0, cEpisode->intervals.count());
+            }
+        }
+        bulkEpisodes.clear();
+    }
+}
+
+// Sets maxEndMsecs for the subtree rooted at the middle of [nLow, nHigh)
+// and returns it, -1 for an empty range.
+int IntervalIndex::buildMaxEnds(QVector<Interval> &nIntervals, int nLow, int nHigh) {
+    int rMaxEnd = -1;
+
+    if (nLow < nHigh) {
+        int mid = nLow + (nHigh - nLow) / 2;
+        int leftMaxEnd = buildMaxEnds(nIntervals, nLow, mid);
+        int rightMaxEnd = buildMaxEnds(nIntervals, mid + 1, nHigh);
+
+        rMaxEnd = qMax(nIntervals.at(mid).endMsecs, qMax(leftMaxEnd, rightMaxEnd));
+        nIntervals[mid].maxEndMsecs = rMaxEnd;
+    }
+
+    return rMaxEnd;
+}
+
+void IntervalIndex::collectOverlapping(const QVector<Interval> &nIntervals, int nLow, int nHigh,
+                                       int nStartMsecs, int nEndMsecs, QVector<int> &rIds) {
+    if (nLow < nHigh) {
+        int mid = nLow + (nHigh - nLow) / 2;
+        const Interval &cInterval = nIntervals.at(mid);
+
+        if (cInterval.maxEndMsecs >= nStartMsecs) {
+            collectOverlapping(nIntervals, nLow, mid, nStartMsecs, nEndMsecs, rIds);
+
+            if (cInterval.startMsecs <= nEndMsecs) {
+                if (cInterval.endMsecs >= nStartMsecs) {
+                    rIds.append(cInterval.clipId);
+                }
+                collectOverlapping(nIntervals, mid + 1, nHigh, nStartMsecs, nEndMsecs, rIds);
+            }
+        }
+    }
+}
+
+// Clips sharing at least one instant with [nStartMsecs, nEndMsecs], sorted by id.
+QVector<int> IntervalIndex::overlapping(int nShowId, int nEpNum, int nStartMsecs, int nEndMsecs) const {
+    QVector<int> rIds;
+    QHash<quint64, Episode>::const_iterator cEpisode = episodes.constFind(episodeKey(nShowId, nEpNum));
+
+    if (cEpisode != episodes.constEnd()) {
+        collectOverlapping(cEpisode->intervals, 0, cEpisode->intervals.count(), nStartMsecs, nEndMsecs, rIds);
+        qSort(rIds);
+    }
+
+    return rIds;
+}
+
+// Clips lying entirely inside [nStartMsecs, nEndMsecs], sorted by id.
+QVector<int> IntervalIndex::within(int nShowId, int nEpNum, int nStartMsecs, int nEndMsecs) const {
+    QVector<int> rIds;
+    QHash<quint64, Episode>::const_iterator cEpisode = episodes.constFind(episodeKey(nShowId, nEpNum));
+
+    if (cEpisode != episodes.constEnd()) {
+        Interval first;
+        first.startMsecs = nStartMsecs;
+        first.endMsecs = -1;
+        first.clipId = -1;
+        first.maxEndMsecs = -1;
+
+        QVector<Interval>::const_iterator cPos = qLowerBound(cEpisode->intervals.constBegin(), cEpisode->intervals.constEnd(), first);
+
+        for (; cPos != cEpisode->intervals.constEnd() && cPos->startMsecs <= nEndMsecs; ++cPos) {
+            if (cPos->endMsecs <= nEndMsecs) {
+                rIds.append(cPos->clipId);
+            }
+        }
+        qSort(rIds);
+    }
+
+    return rIds;
+}
+
+int IntervalIndex::episodeCount(int nShowId, int nEpNum) const {
+    return episodes.value(episodeKey(nShowId, nEpNum)).intervals.count();
+}
+
+// Clips that share at least one instant with another clip of their episode,
+// in one sweep per episode. A clip overlaps an earlier one exactly when it
+// starts before the latest end seen so far; that earlier clip is marked
+// too. Only valid outside bulk mode.
+int IntervalIndex::countOverlapping() const {
+    int rCount = 0;
+    QVector<bool> marked;
+
+    QHash<quint64, Episode>::const_iterator cEpisode = episodes.constBegin();
+    for (; cEpisode != episodes.constEnd(); ++cEpisode) {
+        const QVector<Interval> &cIntervals = cEpisode->intervals;
+        marked.fill(false, cIntervals.count());
+        int latest = -1;
+
+        for (int i = 0; i < cIntervals.count(); i++) {
+            if (latest != -1 && cIntervals.at(i).startMsecs <= cIntervals.at(latest).endMsecs) {
+                marked[i] = true;
+                marked[latest] = true;
+            }
+            if (latest == -1 || cIntervals.at(i).endMsecs > cIntervals.at(latest).endMsecs) {
+                latest = i;
+            }
+        }
+
+        rCount += marked.count(true);
+    }
+
+    return rCount;
+}
+
+// Clips whose length is within [nLowMsecs, nHighMsecs], sorted by id. -1 leaves
+// that side open.
+QVector<int> IntervalIndex::byLength(int nLowMsecs, int nHighMsecs) const {
+    QVector<int> rIds;
+    QMap<int, QVector<int> >::const_iterator cLength = (nLowMsecs == -1) ? lengths.constBegin() : lengths.lowerBound(nLowMsecs);
+    QMap<int, QVector<int> >::const_iterator cEnd = (nHighMsecs == -1) ? lengths.constEnd() : lengths.upperBound(nHighMsecs);
+
+    for (; cLength != cEnd; ++cLength) {
+        rIds += cLength.value();
+    }
+    qSort(rIds);
+
+    return rIds;
+}
+
+int IntervalIndex::countByLength(int nLowMsecs, int nHighMsecs) const {
+    int rCount = 0;
+    QMap<int, QVector<int> >::const_iterator cLength = (nLowMsecs == -1) ? lengths.constBegin() : lengths.lowerBound(nLowMsecs);
+    QMap<int, QVector<int> >::const_iterator cEnd = (nHighMsecs == -1) ? lengths.constEnd() : lengths.upperBound(nHighMsecs);
+
+    for (; cLength != cEnd; ++cLength) {
+        rCount += cLength.value().count();
+    }
+
+    return rCount;
+}
+
+qint64 IntervalIndex::memoryUsage() const {
+    qint64 rBytes = episodes.capacity() * sizeof(void*);
+
+    QHash<quint64, Episode>::const_iterator cEpisode = episodes.constBegin();
+    for (; cEpisode != episodes.constEnd(); ++cEpisode) {
+        rBytes += sizeof(void*) + sizeof(uint) + sizeof(quint64) + sizeof(Episode);
+        rBytes += cEpisode->intervals.capacity() * sizeof(Interval);
+    }
+
+    QMap<int, QVector<int> >::const_iterator cLength = lengths.constBegin();
+    for (; cLength != lengths.constEnd(); ++cLength) {
+        rBytes += 3 * sizeof(void*) + sizeof(int) + sizeof(QVector<int>);
+        rBytes += cLength->capacity() * sizeof(int);
+    }
+
+    return rBytes;
+}
@@ -0,0 +1,75 @@
+#ifndef INTERVALINDEX_H
+#define INTERVALINDEX_H
+
+#include <QVector>
+#include <QHash>
+#include <QMap>
+#include <QSet>
+
+struct Clip;
+
+// Time bound indexes over the clips in a ClipStore.
+//
+// Each (show, episode) keeps its clips sorted by start time. The sorted
+// array doubles as a balanced interval tree: the middle of any range is
+// the root of that range, and every entry carries the latest end time in
+// its subtree. An overlap query skips subtrees that end too early, so it
+// costs O(log n) per clip found. Containment is a binary search plus a
+// walk over the clips starting inside the range. Adding or removing a clip
+// rebuilds its episode's end times, which is linear like the insert into
+// the array itself. In bulk mode clips are appended unsorted and each
+// touched episode is sorted and rebuilt once when bulk mode ends; episode
+// queries are not valid until then. Clip lengths go into an ordered
+// histogram of length to clip ids for duration range queries.
+//
+// All times are milliseconds since the start of the episode. Clips with an
+// invalid start or end are not indexed.
+class IntervalIndex
+{
+public:
+    IntervalIndex();
+
+    void addClip(int nClipId, const Clip &nClip);
+    void removeClip(int nClipId, const Clip &nClip);
+    void clear();
+    void setBulkLoad(bool nBulk);
+
+    QVector<int> overlapping(int nShowId, int nEpNum, int nStartMsecs, int nEndMsecs) const;
+    QVector<int> within(int nShowId, int nEpNum, int nStartMsecs, int nEndMsecs) const;
+    int episodeCount(int nShowId, int nEpNum) const;
+    int countOverlapping() const;
+
+    QVector<int> byLength(int nLowMsecs, int nHighMsecs) const;
+    int countByLength(int nLowMsecs, int nHighMsecs) const;
+
+    qint64 memoryUsage() const;
+
+private:
+    struct Interval {
+        int startMsecs;
+        int endMsecs;
+        int clipId;
+        int maxEndMsecs;
+
+        bool operator<(const Interval &oInterval) const;
+    };
+
+    struct Episode {
+        QVector<Interval> intervals;
+
+        Episode() : intervals() {}
+    };
+
+    static quint64 episodeKey(int nShowId, int nEpNum);
+    static int buildMaxEnds(QVector<Interval> &nIntervals, int nLow, int nHigh);
+    static void collectOverlapping(const QVector<Interval> &nIntervals, int nLow, int nHigh,
+                                   int nStartMsecs, int nEndMsecs, QVector<int> &rIds);
+
+    QHash<quint64, Episode> episodes;
+    QMap<int, QVector<int> > lengths;
+
+    bool bulk_flag;
+    QSet<quint64> bulkEpisodes;
+};
+
+#endif // INTERVALINDEX_H
@@ -0,0 +1,204 @@
+#include "logfile.h"
+
+#include <QDir>
+#include <QFileInfo>
+#include <QDebug>
+
+using namespace logger;
+
+namespace {
+
+const char *headerPrefix = "# Log opened ";
+
+}
+
+LogFileConfig::LogFileConfig() :
+    filename(),
+    maxBytes(1024 * 1024),
+    maxHours(24),
+    compress_flag(true),
+    budgetBytes(20 * 1024 * 1024)
+{
+
+}
+
+LogFile::LogFile() :
+    config(),
+    file(),
+    openedAt(),
+    numBytes(0)
+{
+
+}
+
+LogFile::~LogFile() {
+    close();
+}
+
+// Appends to an existing file unless it is already due for rotation. A
+// non empty file without an opened line is of unknown age and is rolled.
+bool LogFile::open(const LogFileConfig &nConfig) {
+    close();
+    config = nConfig;
+
+    if (!config.filename.isEmpty()) {
+        QFileInfo info(config.filename);
+        QDir().mkpath(info.absolutePath());
+
+        file.setFileName(config.filename);
+        openedAt = readOpenedAt(config.filename);
+
+        bool unknown_flag = info.exists() && info.size() > 0 && !openedAt.isValid();
+        bool age_flag = openedAt.isValid() && config.maxHours > 0 && openedAt.secsTo(QDateTime::currentDateTime()) > config.maxHours * 3600;
+
+        if (unknown_flag || age_flag) {
+            rotate();
+        }
+        else if (file.open(QIODevice::WriteOnly | QIODevice::Append | QIODevice::Text)) {
+            numBytes = file.size();
+            if (numBytes == 0) {
+                writeHeader();
+            }
+            enforceBudget();
+        }
+        else {
+            qDebug() << "Logger: Unable to open log file" << config.filename << file.errorString();
+        }
+    }
+
+    return file.isOpen();
+}
+
+void LogFile::close() {
+    if (file.isOpen()) {
+        file.close();
+    }
+}
+
+bool LogFile::isOpen() const {
+    return file.isOpen();
+}
+
+void LogFile::write(const QString &nLine) {
+    if (file.isOpen()) {
+        bool size_flag = config.maxBytes > 0 && numBytes >= config.maxBytes;
+        bool age_flag = config.maxHours > 0 && openedAt.secsTo(QDateTime::currentDateTime()) > config.maxHours * 3600;
+
+        if (size_flag || age_flag) {
+            rotate();
+        }
+    }
+
+    if (file.isOpen()) {
+        QByteArray line = nLine.toUtf8();
+        line.append('\n');
+        numBytes += file.write(line);
+    }
+}
+
+void LogFile::flush() {
+    if (file.isOpen()) {
+        file.flush();
+    }
+}
+
+void LogFile::rotate() {
+    close();
+
+    QFileInfo info(config.filename);
+    QString rolled = QString("%1/%2.%3.%4").arg(info.absolutePath())
+                                           .arg(info.completeBaseName())
+                                           .arg(QDateTime::currentDateTime().toString("yyyyMMdd_HHmmsszzz"))
+                                           .arg(info.suffix().isEmpty() ? QString("log") : info.suffix());
+
+    if (info.exists()) {
+        if (QFile::rename(config.filename, rolled)) {
+            if (config.compress_flag) {
+                compress(rolled);
+            }
+        }
+        else {
+            qDebug() << "Logger: Unable to roll log file" << config.filename;
+        }
+    }
+
+    numBytes = 0;
+    if (file.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text)) {
+        writeHeader();
+    }
+    else {
+        qDebug() << "Logger: Unable to open log file" << config.filename << file.errorString();
+    }
+
+    enforceBudget();
+}
+
+void LogFile::writeHeader() {
+    openedAt = QDateTime::currentDateTime();
+
+    QByteArray line = QString(headerPrefix + openedAt.toString(Qt::ISODate)).toUtf8();
+    line.append('\n');
+    numBytes += file.write(line);
+}
+
+// Time stamp from the first line of nFilename; invalid if there is none.
+QDateTime LogFile::readOpenedAt(const QString &nFilename) {
+    QDateTime rOpenedAt;
+    QFile existing(nFilename);
+
+    if (existing.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        QString first = QString::fromUtf8(existing.readLine(128)).trimmed();
+        if (first.startsWith(headerPrefix)) {
+            rOpenedAt = QDateTime::fromString(first.mid(qstrlen(headerPrefix)), Qt::ISODate);
+        }
+        existing.close();
+    }
+
+    return rOpenedAt;
+}
+
+// Replaces nFilename with nFilename.qz, written with qCompress.
+bool LogFile::compress(const QString &nFilename) {
+    bool rCompressed_flag = false;
+    QFile plain(nFilename);
+
+    if (plain.open(QIODevice::ReadOnly)) {
+        QByteArray packed = qCompress(plain.readAll(), 9);
+        plain.close();
+
+        QFile out(nFilename + ".qz");
+        if (out.open(QIODevice::WriteOnly | QIODevice::Truncate) && out.write(packed) == packed.size()) {
+            out.close();
+            rCompressed_flag = plain.remove();
+        }
+        else {
+            out.remove();
+        }
+    }
+
+    return rCompressed_flag;
+}
+
+// Rolled files sort by their time stamp, so the oldest go first.
+void LogFile::enforceBudget() {
+    if (config.budgetBytes > 0) {
+        QFileInfo info(config.filename);
+        QDir dir(info.absolutePath());
+        QFileInfoList rolled = dir.entryInfoList(QStringList() << rolledFilter(), QDir::Files, QDir::Name);
+
+        qint64 total = numBytes;
+        for (int i = 0; i < rolled.count(); i++) {
+            total += rolled.at(i).size();
+        }
+
+        for (int i = 0; i < rolled.count() && total > config.budgetBytes; i++) {
+            if (QFile::remove(rolled.at(i).absoluteFilePath())) {
+                total -= rolled.at(i).size();
+            }
+        }
+    }
+}
+
+QString LogFile::rolledFilter() const {
+    return QFileInfo(config.filename).completeBaseName() + ".*_*";
+}
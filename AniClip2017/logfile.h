@@ -0,0 +1,58 @@
+#ifndef LOGFILE_H
+#define LOGFILE_H
+
+#include <QString>
+#include <QFile>
+#include <QDateTime>
+
+namespace logger {
+
+// File sink options from the logger config. An empty filename turns the
+// file sink off; zero sizes and ages mean no limit.
+struct LogFileConfig {
+    LogFileConfig();
+
+    QString filename;
+    qint64  maxBytes;
+    int     maxHours;
+    bool    compress_flag;
+    qint64  budgetBytes;
+};
+
+// Log file that rolls over by size and age. A rolled file is renamed to
+// <name>.<yyyyMMdd_HHmmsszzz>.<suffix>, compressed if asked, and the oldest
+// rolled files are removed while the log directory is over budget. Each
+// file starts with a line recording when it was opened, so its age carries
+// over restarts that append to it. Only used from the sink thread.
+class LogFile
+{
+public:
+    LogFile();
+    ~LogFile();
+
+    bool open(const LogFileConfig &nConfig);
+    void close();
+    bool isOpen() const;
+
+    void write(const QString &nLine);
+    void flush();
+
+private:
+    Q_DISABLE_COPY(LogFile)
+
+    void rotate();
+    void writeHeader();
+    static QDateTime readOpenedAt(const QString &nFilename);
+    bool compress(const QString &nFilename);
+    void enforceBudget();
+    QString rolledFilter() const;
+
+    LogFileConfig config;
+    QFile file;
+    QDateTime openedAt;
+    qint64 numBytes;
+};
+
+}
+
+#endif // LOGFILE_H
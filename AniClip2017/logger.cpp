@@ -1,29 +1,151 @@
 #include "logger.h"
+#include "logring.h"
+#include "logsink.h"
+
 #include <QFile>
 #include <QDebug>
 #include <QDir>
+#include <QThread>
+#include <QTextStream>
+#include <QRegExp>
 using namespace logger;
 
-LogItem::LogItem(QObject* parent): QObject(parent),
+LogArg::LogArg() :
+kind(ARG_NONE),
+intValue(0),
+doubleValue(0.0),
+stringValue()
+{
+
+}
+
+LogArg::LogArg(int nValue) :
+kind(ARG_INT),
+intValue(nValue),
+doubleValue(0.0),
+stringValue()
+{
+
+}
+
+LogArg::LogArg(uint nValue) :
+kind(ARG_INT),
+intValue(nValue),
+doubleValue(0.0),
+stringValue()
+{
+
+}
+
+LogArg::LogArg(qint64 nValue) :
+kind(ARG_INT),
+intValue(nValue),
+doubleValue(0.0),
+stringValue()
+{
+
+}
+
+LogArg::LogArg(double nValue) :
+kind(ARG_DOUBLE),
+intValue(0),
+doubleValue(nValue),
+stringValue()
+{
+
+}
+
+LogArg::LogArg(const QString &nValue) :
+kind(ARG_STRING),
+intValue(0),
+doubleValue(0.0),
+stringValue(nValue)
+{
+
+}
+
+LogArg::LogArg(const char *nValue) :
+kind(ARG_STRING),
+intValue(0),
+doubleValue(0.0),
+stringValue(QString::fromUtf8(nValue))
+{
+
+}
+
+QString LogArg::apply(const QString &nFormat) const {
+    QString rText;
+
+    switch (kind) {
+    case ARG_INT:
+        rText = nFormat.arg(intValue);
+        break;
+    case ARG_DOUBLE:
+        rText = nFormat.arg(doubleValue, 0, 'f', 2);
+        break;
+    case ARG_STRING:
+        rText = nFormat.arg(stringValue);
+        break;
+    case ARG_NONE:
+        rText = nFormat;
+        break;
+    }
+
+    return rText;
+}
+
+LogRecord::LogRecord() :
 type(LogType::LOG_INFO),
-msg(""),
-used_flag(false)
+time(0),
+format(NULL),
+msg(),
+numArgs(0)
 {
 
 }
 
+// Message text without the level prefix.
+QString LogRecord::text() const {
+    QString rText = msg;
+
+    if (format != NULL) {
+        rText = QString::fromUtf8(format);
+        for (int i = 0; i < numArgs; i++) {
+            rText = args[i].apply(rText);
+        }
+    }
+
+    return rText;
+}
+
 Logger::Logger(QObject* parent): QObject(parent),
-log(),
 configFilename(),
-numAllocated_items(500),
-error_flag(false)
+ring(NULL),
+sink(NULL),
+minLevel(LOG_TRACE)
 {
+    ring = new LogRing(8192);
+    sink = new LogSink(ring, 2000);
+    sink->start(QThread::LowPriority);
+}
 
+Logger::~Logger() {
+    // The sink drains the ring before it exits.
+    delete sink;
+    delete ring;
 }
 
+// Options, one per line as "<name> <value>":
+//  log_filename    file to write to; no file sink without it
+//  log_max_kb      size a file may reach before it is rolled over
+//  log_max_hours   age a file may reach before it is rolled over
+//  log_compress    compress rolled files (true/false)
+//  log_budget_kb   disk space for the current and all rolled files
+//  log_level       trace, debug, info, warn or error
 bool Logger::init(QString config) {
     bool initSuccess_flag = true;
     bool fileOpen_flag = false;
+    LogFileConfig fileConfig;
 
     //Look For config Options
     configFilename = config;
@@ -31,7 +153,44 @@ bool Logger::init(QString config) {
 
     if (configFile.open(QIODevice::ReadOnly | QIODevice::Text)) {
         fileOpen_flag = true;
-
+        QTextStream tStream(&configFile);
+
+        while (!tStream.atEnd()) {
+            QString line = tStream.readLine();
+
+            if (!line.isEmpty() && !line.startsWith('#')) {
+                QStringList lineSplit = line.split(QRegExp("\\s+"));
+
+                if (lineSplit.count() >= 2) {
+                    QString id = lineSplit.at(0).trimmed();
+                    QString input = lineSplit.at(1).trimmed();
+
+                    if (id == "log_filename") {
+                        fileConfig.filename = input;
+                    }
+                    else if (id == "log_max_kb") {
+                        fileConfig.maxBytes = input.toLongLong() * 1024;
+                    }
+                    else if (id == "log_max_hours") {
+                        fileConfig.maxHours = input.toInt();
+                    }
+                    else if (id == "log_compress") {
+                        fileConfig.compress_flag = (input != "false" && input != "0");
+                    }
+                    else if (id == "log_budget_kb") {
+                        fileConfig.budgetBytes = input.toLongLong() * 1024;
+                    }
+                    else if (id == "log_level") {
+                        static const char *levels[] = {"trace", "debug", "info", "warn", "error"};
+                        for (int i = LOG_TRACE; i <= LOG_ERROR; i++) {
+                            if (input == levels[i]) {
+                                setLevel(LogType(i));
+                            }
+                        }
+                    }
+                }
+            }
+        }
 
         configFile.close();
     }
@@ -39,160 +198,101 @@ bool Logger::init(QString config) {
         initSuccess_flag = false;
     }
 
-    //Init LogItems
-
-    if (allocateItems(numAllocated_items)) {
-        if (!fileOpen_flag) {
-            warn(QString("Unable to open config file %1/%2.").arg(QDir::currentPath()).arg(configFilename));
-        }
-
-        info(QString("Allocated %1 LogItems.").arg(numAllocated_items));
-
-    }
-    else { //allocateItems(numAllocated_items)
-        initSuccess_flag = false;
-        qDebug() << "Error - Unable to allocate Log Items";
+    if (!fileOpen_flag) {
+        warn(QString("Unable to open config file %1/%2.").arg(QDir::currentPath()).arg(configFilename));
     }
 
+    if (!fileConfig.filename.isEmpty()) {
+        sink->setFile(fileConfig);
+        info("Logging to %1 (%2 KB per file, %3 KB in total).", fileConfig.filename, fileConfig.maxBytes / 1024, fileConfig.budgetBytes / 1024);
+    }
 
+    info(QString("Log ring holds %1 messages.").arg(ring->capacity()));
 
     return initSuccess_flag;
 }
 
-bool Logger::allocateItems(int num) {
-    bool return_flag = true;
-    int numSuccess_items = 0;
-    for (int i = 0; i < numAllocated_items; i++) {
-        LogItem *nItem = new LogItem(this);
-
-        if (nItem != NULL) {
-            log_pool.append(nItem);
-            numSuccess_items++;
-        }
-    }
-
-    if (numSuccess_items < num) {
-        return_flag = false;
-    }
-
-    return return_flag;
+void Logger::setLevel(LogType nLevel) {
+    minLevel.store(nLevel);
 }
 
-void Logger::trace(QString nMsg) {
-    if (log_pool.empty()) {
-        if (!allocateItems(numAllocated_items)) {
-            qDebug () << "Unable to allocate new Items";
-            error_flag = true;
-        }
-    }
-
-    if (!error_flag) {
-        LogItem* nItem = log_pool.takeLast();
+bool Logger::isEnabled(LogType nType) const {
+    return nType >= minLevel.load();
+}
 
-        nItem->type = LogType::LOG_TRACE;
-        nItem->msg = "TRACE - " + nMsg;
+// Waits until everything logged so far has been written by the sink, so
+// getLogString and getLogError include it.
+void Logger::flush() {
+    sink->waitForWritten(ring->pushed());
+}
 
-        log.append(nItem);
-        qDebug().noquote() << nItem->msg;
+void Logger::write(LogType nType, const QString &nMsg) {
+    if (isEnabled(nType) && ring->push(nType, NULL, nMsg, NULL, 0)) {
+        sink->wake();
     }
 }
 
-void Logger::debug(QString nMsg) {
-    if (log_pool.empty()) {
-        if (!allocateItems(numAllocated_items)) {
-            qDebug () << "Unable to allocate new Items";
-            error_flag = true;
+void Logger::write(LogType nType, const char *nFormat, const LogArg &a1, const LogArg &a2, const LogArg &a3, const LogArg &a4) {
+    if (isEnabled(nType)) {
+        const LogArg *nArgs[LOGGER_MAX_ARGS] = {&a1, &a2, &a3, &a4};
+        int numArgs = 0;
+        while (numArgs < LOGGER_MAX_ARGS && nArgs[numArgs]->kind != LogArg::ARG_NONE) {
+            numArgs++;
         }
-    }
 
-    if (!error_flag) {
-        LogItem* nItem = log_pool.takeLast();
-
-        nItem->type = LogType::LOG_DEBUG;
-        nItem->msg = "DEBUG - " + nMsg;
-
-        log.append(nItem);
-        qDebug().noquote() << nItem->msg;
+        if (ring->push(nType, nFormat, QString(), nArgs, numArgs)) {
+            sink->wake();
+        }
     }
 }
 
 void Logger::info(QString nMsg) {
-    if (log_pool.empty()) {
-        if (!allocateItems(numAllocated_items)) {
-            qDebug() << "Unable to allocate new Items";
-            error_flag = true;
-        }
-    }
-
-    if (!error_flag) {
-        LogItem* nItem = log_pool.takeLast();
-
-        nItem->type = LogType::LOG_INFO;
-        nItem->msg = "INFO  - " + nMsg;
-
-        log.append(nItem);
-        qDebug().noquote() << nItem->msg;
-    }
+    write(LOG_INFO, nMsg);
 }
 
 void Logger::warn(QString nMsg) {
-    if (log_pool.empty()) {
-        if (!allocateItems(numAllocated_items)) {
-            qDebug () << "Unable to allocate new Items";
-            error_flag = true;
-        }
-    }
-
-    if (!error_flag) {
-        LogItem* nItem = log_pool.takeLast();
-
-        nItem->type = LogType::LOG_WARN;
-        nItem->msg = "WARN  - " + nMsg;
-
-        log.append(nItem);
-        qDebug().noquote() << nItem->msg;
-    }
+    write(LOG_WARN, nMsg);
 }
 
 void Logger::err(QString nMsg) {
-    if (log_pool.empty()) {
-        if (!allocateItems(numAllocated_items)) {
-            qDebug () << "Unable to allocate new Items";
-            error_flag = true;
-        }
-    }
-
-    if (!error_flag) {
-        LogItem* nItem = log_pool.takeLast();
-
-        nItem->type = LogType::LOG_ERROR;
-        nItem->msg = "ERROR - " + nMsg;
+    write(LOG_ERROR, nMsg);
+}
 
-        log.append(nItem);
-        qDebug().noquote() << nItem->msg;
-    }
+void Logger::info(const char *nFormat, const LogArg &a1, const LogArg &a2, const LogArg &a3, const LogArg &a4) {
+    write(LOG_INFO, nFormat, a1, a2, a3, a4);
+}
 
+void Logger::warn(const char *nFormat, const LogArg &a1, const LogArg &a2, const LogArg &a3, const LogArg &a4) {
+    write(LOG_WARN, nFormat, a1, a2, a3, a4);
 }
 
-QStringList Logger::getLogString() {
+void Logger::err(const char *nFormat, const LogArg &a1, const LogArg &a2, const LogArg &a3, const LogArg &a4) {
+    write(LOG_ERROR, nFormat, a1, a2, a3, a4);
+}
 
-    QStringList rList;
+// Messages queued since the logger was created. Wraps around.
+uint Logger::getMessageCount() const {
+    return ring->pushed();
+}
 
-    for (int i = 0; i < log.count(); i++) {
-        rList << log.at(i)->msg;
-    }
+int Logger::getDroppedCount() const {
+    return sink->getDroppedCount();
+}
 
-    return rList;
+// The most recent lines the sink kept, oldest first.
+QStringList Logger::getLogString() {
+    flush();
+    return sink->history();
 }
 
 QString Logger::getLogError() {
+    flush();
     QString rList;
 
-    for (int i = 0; i < log.count(); i++) {
-        if (log.at(i)->type == LogType::LOG_ERROR) {
-            rList.append(log.at(i)->msg);
-            rList.append("\n");
-        }
+    QStringList errors = sink->errors();
+    for (int i = 0; i < errors.count(); i++) {
+        rList.append(errors.at(i));
+        rList.append("\n");
     }
 
     return rList;
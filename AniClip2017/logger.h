@@ -3,7 +3,8 @@
 
 #include <QObject>
 #include <QString>
-#include <QVector>
+#include <QStringList>
+#include <QAtomicInt>
 
 namespace logger {
 
@@ -15,27 +16,74 @@ enum LogType {
     LOG_ERROR
 };
 
-class LogItem : QObject
-{
-    Q_OBJECT
+// Messages below this level are compiled out of trace() and debug() calls.
+// Release builds set it to LOG_INFO in the .pro file.
+#ifndef LOGGER_MIN_LEVEL
+#define LOGGER_MIN_LEVEL 0
+#endif
 
-public:
-    LogItem(QObject *parent = 0);
+#define LOGGER_MAX_ARGS 4
+
+// Argument of a structured message. Holds the value as given; turning it
+// into text is left to whoever renders the record.
+struct LogArg {
+    enum Kind {
+        ARG_NONE,
+        ARG_INT,
+        ARG_DOUBLE,
+        ARG_STRING
+    };
+
+    LogArg();
+    LogArg(int nValue);
+    LogArg(uint nValue);
+    LogArg(qint64 nValue);
+    LogArg(double nValue);
+    LogArg(const QString &nValue);
+    LogArg(const char *nValue);
+
+    QString apply(const QString &nFormat) const;
 
-    LogType type;
-    QString msg;
+    Kind    kind;
+    qint64  intValue;
+    double  doubleValue;
+    QString stringValue;
+};
+
+// One queued message. Either msg is the finished text, or format is a
+// string literal with %1.. markers for args. Prefix and line are only built
+// by the sink.
+struct LogRecord {
+    LogRecord();
+
+    QString text() const;
 
-    bool used_flag;
+    LogType     type;
+    qint64      time;
+    const char  *format;
+    QString     msg;
+    int         numArgs;
+    LogArg      args[LOGGER_MAX_ARGS];
 };
 
+class LogRing;
+class LogSink;
+
+// Safe to call from any thread. Messages below the minimum level are
+// dropped before anything is queued; the rest go into a bounded LogRing and
+// are written out by a LogSink thread.
 class Logger : QObject
 {
     Q_OBJECT
 
 public:
     Logger(QObject *parent = 0);
+    ~Logger();
     bool init(QString config);
-    bool allocateItems(int num);
+
+    void setLevel(LogType nLevel);
+    bool isEnabled(LogType nType) const;
+    void flush();
 
     void trace(QString nMsg);
     void debug(QString nMsg);
@@ -43,17 +91,57 @@ public:
     void warn(QString nMsg);
     void err(QString nMsg);
 
+    // Structured forms: nFormat must be a string literal. Only the values are
+    // captured here, so a message that is filtered out or never read costs
+    // no formatting.
+    void trace(const char *nFormat, const LogArg &a1, const LogArg &a2 = LogArg(), const LogArg &a3 = LogArg(), const LogArg &a4 = LogArg());
+    void debug(const char *nFormat, const LogArg &a1, const LogArg &a2 = LogArg(), const LogArg &a3 = LogArg(), const LogArg &a4 = LogArg());
+    void info(const char *nFormat, const LogArg &a1, const LogArg &a2 = LogArg(), const LogArg &a3 = LogArg(), const LogArg &a4 = LogArg());
+    void warn(const char *nFormat, const LogArg &a1, const LogArg &a2 = LogArg(), const LogArg &a3 = LogArg(), const LogArg &a4 = LogArg());
+    void err(const char *nFormat, const LogArg &a1, const LogArg &a2 = LogArg(), const LogArg &a3 = LogArg(), const LogArg &a4 = LogArg());
+
     QStringList getLogString();
     QString getLogError();
 
-    QVector<LogItem*> log;
-    QVector<LogItem*> log_pool;
+    uint getMessageCount() const;
+    int getDroppedCount() const;
+
     QString configFilename;
-    int numAllocated_items;
 
-    bool error_flag;
+private:
+    void write(LogType nType, const QString &nMsg);
+    void write(LogType nType, const char *nFormat, const LogArg &a1, const LogArg &a2, const LogArg &a3, const LogArg &a4);
+
+    LogRing *ring;
+    LogSink *sink;
+
+    QAtomicInt minLevel;
 };
 
+inline void Logger::trace(QString nMsg) {
+    if (LOGGER_MIN_LEVEL <= LOG_TRACE) {
+        write(LOG_TRACE, nMsg);
+    }
+}
+
+inline void Logger::debug(QString nMsg) {
+    if (LOGGER_MIN_LEVEL <= LOG_DEBUG) {
+        write(LOG_DEBUG, nMsg);
+    }
+}
+
+inline void Logger::trace(const char *nFormat, const LogArg &a1, const LogArg &a2, const LogArg &a3, const LogArg &a4) {
+    if (LOGGER_MIN_LEVEL <= LOG_TRACE) {
+        write(LOG_TRACE, nFormat, a1, a2, a3, a4);
+    }
+}
+
+inline void Logger::debug(const char *nFormat, const LogArg &a1, const LogArg &a2, const LogArg &a3, const LogArg &a4) {
+    if (LOGGER_MIN_LEVEL <= LOG_DEBUG) {
+        write(LOG_DEBUG, nFormat, a1, a2, a3, a4);
+    }
+}
+
 }
 
 #endif // LOGGER_H
@@ -0,0 +1,118 @@
+#include "logring.h"
+
+#include <QDateTime>
+
+using namespace logger;
+
+// nCapacity is rounded up to a power of two.
+LogRing::LogRing(int nCapacity) :
+    ring(NULL),
+    mask(0),
+    writePos(0),
+    readPos(0),
+    dropped(0)
+{
+    uint size = 2;
+    while (size < uint(nCapacity)) {
+        size <<= 1;
+    }
+
+    ring = new Slot[size];
+    mask = size - 1;
+
+    // A slot is free for the writer whose position equals its sequence and
+    // ready for the reader once the sequence is one past that.
+    for (uint i = 0; i < size; i++) {
+        ring[i].sequence.store(int(i));
+    }
+}
+
+LogRing::~LogRing() {
+    delete[] ring;
+}
+
+// Any thread. Returns false if the ring was full and the record dropped.
+bool LogRing::push(LogType nType, const char *nFormat, const QString &nMsg, const LogArg * const *nArgs, int nNumArgs) {
+    bool rPushed_flag = false;
+    bool done_flag = false;
+    uint pos = uint(writePos.load());
+
+    while (!done_flag) {
+        Slot &cSlot = ring[pos & mask];
+        int diff = int(uint(cSlot.sequence.loadAcquire()) - pos);
+
+        if (diff == 0) {
+            if (writePos.testAndSetRelaxed(int(pos), int(pos + 1))) {
+                cSlot.record.type = nType;
+                cSlot.record.time = QDateTime::currentMSecsSinceEpoch();
+                cSlot.record.format = nFormat;
+                cSlot.record.msg = nMsg;
+                cSlot.record.numArgs = nNumArgs;
+                for (int i = 0; i < nNumArgs; i++) {
+                    cSlot.record.args[i] = *nArgs[i];
+                }
+                cSlot.sequence.storeRelease(int(pos + 1));
+
+                rPushed_flag = true;
+                done_flag = true;
+            }
+            else {
+                pos = uint(writePos.load());
+            }
+        }
+        else if (diff < 0) {
+            // The sink has not freed this slot from the previous lap.
+            dropped.fetchAndAddRelaxed(1);
+            done_flag = true;
+        }
+        else {
+            pos = uint(writePos.load());
+        }
+    }
+
+    return rPushed_flag;
+}
+
+// Sink thread only. Returns false if nothing is ready.
+bool LogRing::pop(LogRecord &rRecord) {
+    bool rPopped_flag = false;
+    uint pos = uint(readPos.load());
+    Slot &cSlot = ring[pos & mask];
+
+    if (int(uint(cSlot.sequence.loadAcquire()) - (pos + 1)) == 0) {
+        rRecord = cSlot.record;
+        cSlot.record.msg.clear();
+        for (int i = 0; i < cSlot.record.numArgs; i++) {
+            cSlot.record.args[i].stringValue.clear();
+        }
+        cSlot.sequence.storeRelease(int(pos + mask + 1));
+        readPos.storeRelease(int(pos + 1));
+
+        rPopped_flag = true;
+    }
+
+    return rPopped_flag;
+}
+
+// Sink thread only. True if the next record is not published yet.
+bool LogRing::isEmpty() const {
+    uint pos = uint(readPos.load());
+    return int(uint(ring[pos & mask].sequence.loadAcquire()) - (pos + 1)) != 0;
+}
+
+int LogRing::capacity() const {
+    return int(mask + 1);
+}
+
+// Records dropped since the last call.
+int LogRing::takeDropped() {
+    return dropped.fetchAndStoreRelaxed(0);
+}
+
+uint LogRing::pushed() const {
+    return uint(writePos.load());
+}
+
+uint LogRing::popped() const {
+    return uint(readPos.loadAcquire());
+}
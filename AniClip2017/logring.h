@@ -0,0 +1,50 @@
+#ifndef LOGRING_H
+#define LOGRING_H
+
+#include <QAtomicInt>
+#include <QString>
+
+#include "logger.h"
+
+namespace logger {
+
+// Fixed size queue of log records between any number of logging threads and
+// one sink thread. A writer claims a slot with a compare and swap on the
+// write position and publishes it through the slot's sequence number, so
+// writers never take a lock or allocate. When the sink falls a whole ring
+// behind, new records are dropped and counted instead of blocking.
+class LogRing
+{
+public:
+    explicit LogRing(int nCapacity);
+    ~LogRing();
+
+    bool push(LogType nType, const char *nFormat, const QString &nMsg, const LogArg * const *nArgs, int nNumArgs);
+    bool pop(LogRecord &rRecord);
+
+    bool isEmpty() const;
+    int capacity() const;
+    int takeDropped();
+
+    uint pushed() const;
+    uint popped() const;
+
+private:
+    Q_DISABLE_COPY(LogRing)
+
+    struct Slot {
+        QAtomicInt  sequence;
+        LogRecord   record;
+    };
+
+    Slot *ring;
+    uint mask;
+
+    QAtomicInt writePos;
+    QAtomicInt readPos;
+    QAtomicInt dropped;
+};
+
+}
+
+#endif // LOGRING_H
@@ -0,0 +1,211 @@
+#include "logsink.h"
+#include "logring.h"
+
+#include <QDebug>
+#include <QMutexLocker>
+#include <QDateTime>
+
+using namespace logger;
+
+LogSink::LogSink(LogRing *nRing, int nHistory, QObject *parent) : QThread(parent),
+    ring(nRing),
+    file(),
+    mutex(),
+    fileConfig(),
+    fileChanged_flag(false),
+    lines(qMax(nHistory, 1)),
+    nextLine(0),
+    numLines(0),
+    errorLines(),
+    maxErrors(200),
+    waitMutex(),
+    recordsQueued(),
+    recordsWritten(),
+    numWritten(0),
+    finished_flag(false),
+    stop_flag(0),
+    sleeping_flag(0),
+    console_flag(1),
+    numDropped(0)
+{
+
+}
+
+LogSink::~LogSink() {
+    stop();
+    wait();
+}
+
+// Writes out whatever is still queued, then exits.
+void LogSink::stop() {
+    stop_flag.store(1);
+
+    QMutexLocker locker(&waitMutex);
+    recordsQueued.wakeOne();
+}
+
+// Called after every push. Only takes the lock when the sink is asleep, so
+// logging stays lock free while the sink keeps up. The full barrier on the
+// flag pairs with the one in waitForRecords(): either the sink sees the new
+// record when it checks the ring, or this sees it sleeping.
+void LogSink::wake() {
+    if (sleeping_flag.fetchAndAddOrdered(0) != 0) {
+        QMutexLocker locker(&waitMutex);
+        recordsQueued.wakeOne();
+    }
+}
+
+// Blocks until nTarget records, counted from the start, have been written,
+// or the sink has exited.
+void LogSink::waitForWritten(uint nTarget) {
+    QMutexLocker locker(&waitMutex);
+
+    while (int(numWritten - nTarget) < 0 && !finished_flag) {
+        recordsQueued.wakeOne();
+        recordsWritten.wait(&waitMutex);
+    }
+}
+
+void LogSink::setConsole(bool nConsole) {
+    console_flag.store(nConsole ? 1 : 0);
+}
+
+// The sink thread opens the file before it writes the next records.
+void LogSink::setFile(const LogFileConfig &nConfig) {
+    mutex.lock();
+    fileConfig = nConfig;
+    fileChanged_flag = true;
+    mutex.unlock();
+
+    QMutexLocker locker(&waitMutex);
+    recordsQueued.wakeOne();
+}
+
+// Oldest first.
+QStringList LogSink::history() {
+    QMutexLocker locker(&mutex);
+    QStringList rLines;
+
+    int first = (nextLine - numLines + lines.count()) % lines.count();
+    for (int i = 0; i < numLines; i++) {
+        rLines.append(lines.at((first + i) % lines.count()));
+    }
+
+    return rLines;
+}
+
+QStringList LogSink::errors() {
+    QMutexLocker locker(&mutex);
+    return errorLines;
+}
+
+// Messages lost to a full ring since the sink started.
+int LogSink::getDroppedCount() const {
+    return numDropped.load();
+}
+
+QString LogSink::format(const LogRecord &nRecord) {
+    static const char *prefixes[] = {"TRACE - ", "DEBUG - ", "INFO  - ", "WARN  - ", "ERROR - "};
+    return prefixes[nRecord.type] + nRecord.text();
+}
+
+void LogSink::run() {
+    bool running_flag = true;
+
+    while (running_flag) {
+        // Read the flag first so records logged just before stop() are
+        // still drained.
+        bool stopping_flag = stop_flag.load() != 0;
+
+        mutex.lock();
+        bool openFile_flag = fileChanged_flag;
+        LogFileConfig nConfig = fileConfig;
+        fileChanged_flag = false;
+        mutex.unlock();
+
+        if (openFile_flag) {
+            file.open(nConfig);
+        }
+
+        if (drain() > 0) {
+            file.flush();
+        }
+        else {
+            if (stopping_flag) {
+                running_flag = false;
+            }
+            else {
+                waitForRecords();
+            }
+        }
+    }
+
+    file.close();
+
+    QMutexLocker locker(&waitMutex);
+    finished_flag = true;
+    recordsWritten.wakeAll();
+}
+
+// Waits for a push, stop() or setFile(). The checks run under waitMutex,
+// which every waker takes before it signals, so no wake is lost.
+void LogSink::waitForRecords() {
+    QMutexLocker locker(&waitMutex);
+    sleeping_flag.fetchAndStoreOrdered(1);
+
+    mutex.lock();
+    bool fileChanged = fileChanged_flag;
+    mutex.unlock();
+
+    if (ring->isEmpty() && stop_flag.load() == 0 && !fileChanged) {
+        recordsQueued.wait(&waitMutex);
+    }
+
+    sleeping_flag.store(0);
+}
+
+int LogSink::drain() {
+    int rCount = 0;
+    LogRecord cRecord;
+
+    while (ring->pop(cRecord)) {
+        write(format(cRecord), cRecord.type, cRecord.time);
+        rCount++;
+    }
+
+    if (rCount > 0) {
+        QMutexLocker locker(&waitMutex);
+        numWritten += rCount;
+        recordsWritten.wakeAll();
+    }
+
+    int cDropped = ring->takeDropped();
+    if (cDropped > 0) {
+        numDropped.fetchAndAddRelaxed(cDropped);
+        write(QString("WARN  - Logger: %1 messages dropped, the log ring was full.").arg(cDropped), LOG_WARN, QDateTime::currentMSecsSinceEpoch());
+    }
+
+    return rCount;
+}
+
+void LogSink::write(const QString &nLine, LogType nType, qint64 nTime) {
+    if (console_flag.load() != 0) {
+        qDebug().noquote() << nLine;
+    }
+    if (file.isOpen()) {
+        file.write(QDateTime::fromMSecsSinceEpoch(nTime).toString("yyyy-MM-dd HH:mm:ss.zzz ") + nLine);
+    }
+
+    QMutexLocker locker(&mutex);
+
+    lines[nextLine] = nLine;
+    nextLine = (nextLine + 1) % lines.count();
+    numLines = qMin(numLines + 1, lines.count());
+
+    if (nType == LOG_ERROR) {
+        if (errorLines.count() >= maxErrors) {
+            errorLines.removeFirst();
+        }
+        errorLines.append(nLine);
+    }
+}
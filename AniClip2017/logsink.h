@@ -0,0 +1,76 @@
+#ifndef LOGSINK_H
+#define LOGSINK_H
+
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QAtomicInt>
+#include <QStringList>
+#include <QVector>
+
+#include "logger.h"
+#include "logfile.h"
+
+namespace logger {
+
+class LogRing;
+
+// Drains a LogRing on its own thread: formats each record, prints it, writes
+// it to the log file if one is set and keeps the most recent lines (and,
+// separately, errors) for getLogString and getLogError. Only the sink
+// formats or touches the file, so logging threads never do.
+class LogSink : public QThread
+{
+    Q_OBJECT
+public:
+    LogSink(LogRing *nRing, int nHistory, QObject *parent = 0);
+    ~LogSink();
+
+    void stop();
+    void wake();
+    void waitForWritten(uint nTarget);
+    void setConsole(bool nConsole);
+    void setFile(const LogFileConfig &nConfig);
+
+    QStringList history();
+    QStringList errors();
+    int getDroppedCount() const;
+
+    static QString format(const LogRecord &nRecord);
+
+protected:
+    void run();
+
+private:
+    int drain();
+    void waitForRecords();
+    void write(const QString &nLine, LogType nType, qint64 nTime);
+
+    LogRing *ring;
+    LogFile file;
+
+    QMutex mutex;
+    LogFileConfig fileConfig;
+    bool fileChanged_flag;
+    QVector<QString> lines;
+    int nextLine;
+    int numLines;
+    QStringList errorLines;
+    int maxErrors;
+
+    // Guards numWritten and finished_flag and pairs with both conditions.
+    QMutex waitMutex;
+    QWaitCondition recordsQueued;
+    QWaitCondition recordsWritten;
+    uint numWritten;
+    bool finished_flag;
+
+    QAtomicInt stop_flag;
+    QAtomicInt sleeping_flag;
+    QAtomicInt console_flag;
+    QAtomicInt numDropped;
+};
+
+}
+
+#endif // LOGSINK_H
@@ -1,13 +1,17 @@
 #include "mainwindow.h"
+#include "logger.h"
+#include "benchmark.h"
+#include "clipdatabase.h"
+#include "tracer.h"
 #include <QApplication>
 #include <QStringList>
 #include <QMessageBox>
 #include <QStyleFactory>
+#include <QThread>
 
 int main(int argc, char *argv[])
 {
     QApplication a(argc, argv);
-    MainWindow w;
 
     a.setStyle(QStyleFactory::create("Fusion"));
 
@@ -32,17 +36,88 @@ int main(int argc, char *argv[])
     a.setStyleSheet("QToolTip { color: #ffffff; background-color: #2a82da; border: 1px solid white; }");
 
 
+    // Options come first with their values; what is left is the config file.
+    //  --benchmark         run the benchmarks and exit
+    //  --list-backups      list backup generations and exit
+    //  --restore <gen>     restore a backup generation and exit
+    //  --trace [file]      record spans for the whole session and write them
+    //                      as a Chrome trace on exit (aniclip_trace.json)
     QStringList nArgs = a.arguments();
     QString config_filename = "aniclip_config.txt";
+    QString trace_filename;
+    QString restore_gen;
+    bool benchmark_flag = false;
+    bool listBackups_flag = false;
+    bool restore_flag = false;
+    bool trace_flag = false;
+
+    for (int i = 1; i < nArgs.count(); i++) {
+        QString arg = nArgs.at(i);
+
+        if (arg == "--benchmark") {
+            benchmark_flag = true;
+        }
+        else if (arg == "--list-backups") {
+            listBackups_flag = true;
+        }
+        else if (arg == "--restore") {
+            restore_flag = true;
+            if (i + 1 < nArgs.count() && !nArgs.at(i + 1).startsWith("--")) {
+                restore_gen = nArgs.at(++i);
+            }
+        }
+        else if (arg == "--trace") {
+            trace_flag = true;
+            trace_filename = "aniclip_trace.json";
+            if (i + 1 < nArgs.count() && !nArgs.at(i + 1).startsWith("--")) {
+                trace_filename = nArgs.at(++i);
+            }
+        }
+        else {
+            config_filename = arg;
+        }
+    }
+
+    if (benchmark_flag) {
+        logger::Logger benchLog;
+        benchmark::run(&benchLog);
+        return 0;
+    }
+
+    if (listBackups_flag) {
+        logger::Logger backupLog;
+        ClipDatabase backupDb(&backupLog);
+        backupDb.readConfig(config_filename);
+        QStringList backups = backupDb.getBackups();
+        for (int i = 0; i < backups.count(); i++) {
+            backupLog.info(backups.at(i));
+        }
+        return 0;
+    }
+
+    if (restore_flag) {
+        logger::Logger backupLog;
+        ClipDatabase backupDb(&backupLog);
+        backupDb.readConfig(config_filename);
+        return backupDb.restoreBackup(restore_gen) ? 0 : 1;
+    }
 
-    if (nArgs.count() == 2) {
-        config_filename = nArgs.at(1);
+    if (trace_flag) {
+        QThread::currentThread()->setObjectName("GUI");
+        logger::Tracer::setEnabled(true);
     }
 
+    MainWindow w;
+
     if (w.init(config_filename)) {
         w.showMaximized();
         w.show();
-        return a.exec();
+        int rCode = a.exec();
+
+        if (!trace_filename.isEmpty()) {
+            logger::Tracer::exportChromeTrace(trace_filename);
+        }
+        return rCode;
     }
     else {
         QMessageBox errBox;
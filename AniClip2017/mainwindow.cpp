@@ -18,6 +18,7 @@
 #include <QFileDialog>
 
 #include <QCloseEvent>
+#include <QShortcut>
 
 MainWindow::MainWindow(QWidget *parent) :
     QMainWindow(parent),
@@ -33,23 +34,44 @@ MainWindow::MainWindow(QWidget *parent) :
     editScreen_index(-1),
     viewScreen_index(-1),
     menuScreen_index(-1),
-    addScreen_index(-1)
+    addScreen_index(-1),
+    closing_flag(false)
 {
     ui->setupUi(this);
-    log = new logger::Logger(this);
+    log = new logger::Logger();
 
     centralStack = ui->centralStack;
 
 }
 
+// The widgets and the database log through log, and ClipDatabase may still
+// write a pending save while it shuts down, so the logger goes last.
 MainWindow::~MainWindow()
 {
+    delete debugWidget;
+    delete viewScreen;
+    delete clipDatabase;
     delete ui;
+    delete log;
 }
 
-void MainWindow::closeEvent(QCloseEvent* /*event*/) {
+// While the last save is still being written the window stays open, so the
+// status bar keeps painting; saveFinished closes it again once it is done.
+void MainWindow::closeEvent(QCloseEvent *event) {
 
-    clipDatabase->save();
+    if (!closing_flag) {
+        closing_flag = true;
+        clipDatabase->save();
+    }
+
+    if (clipDatabase->isSaving()) {
+        ui->statusBar->showMessage("Waiting for save to finish...");
+        event->ignore();
+    }
+    else {
+        clipDatabase->waitForSave();
+        event->accept();
+    }
 }
 
 bool MainWindow::init(QString config_filename)
@@ -57,6 +79,7 @@ bool MainWindow::init(QString config_filename)
     bool initSuccess_flag = true;
 
     if (log != NULL) {
+        log->init(config_filename);
 
         //Init Clip Database
         {
@@ -66,6 +89,8 @@ bool MainWindow::init(QString config_filename)
             if (clipDatabase != NULL) {
                 if (clipDatabase->init(config_filename)) {
                     clipDbSuccess_flag = true;
+                    connect(clipDatabase, SIGNAL(saveProgress(int,QString)), this, SLOT(updateSaveProgress(int,QString)));
+                    connect(clipDatabase, SIGNAL(saveFinished(bool)), this, SLOT(closeAfterSave()));
                 }
                 else {
                     log->err("MainWindow.init(): Failed to initialize ClipDatabase.");
@@ -96,6 +121,12 @@ bool MainWindow::init(QString config_filename)
                     connect(ui->addScreen_button, SIGNAL(clicked(bool)), this, SLOT(setAddScreen()));
                 }
 
+                // Performance panel in its own window, toggled with F12.
+                debugWidget = new DebugWidget(log, clipDatabase, this);
+                debugWidget->setWindowFlags(Qt::Window);
+                QShortcut *debugShortcut = new QShortcut(QKeySequence(Qt::Key_F12), this);
+                connect(debugShortcut, SIGNAL(activated()), this, SLOT(toggleDebugWidget()));
+
                 setViewScreen();
 
             }
@@ -124,6 +155,21 @@ QString MainWindow::getError() {
     return  rString;
 }
 
+void MainWindow::updateSaveProgress(int nPercent, const QString &nStage) {
+    if (nPercent >= 100) {
+        ui->statusBar->showMessage(nStage, 3000);
+    }
+    else {
+        ui->statusBar->showMessage(QString("%1 (%2%)").arg(nStage).arg(nPercent));
+    }
+}
+
+void MainWindow::closeAfterSave() {
+    if (closing_flag && !clipDatabase->isSaving()) {
+        close();
+    }
+}
+
 void MainWindow::setEditScreen() {
     if (editScreen_index != -1) {
         centralStack->setCurrentIndex(editScreen_index);
@@ -146,6 +192,12 @@ void MainWindow::setMenuScreen() {
     }
 }
 
+void MainWindow::toggleDebugWidget() {
+    if (debugWidget != NULL) {
+        debugWidget->setVisible(!debugWidget->isVisible());
+    }
+}
+
 void MainWindow::setAddScreen() {
     if (addScreen_index != -1) {
         centralStack->setCurrentIndex(addScreen_index);
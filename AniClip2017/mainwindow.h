@@ -38,6 +38,9 @@ public slots:
     void setViewScreen();
     void setMenuScreen();
     void setAddScreen();
+    void toggleDebugWidget();
+    void updateSaveProgress(int nPercent, const QString &nStage);
+    void closeAfterSave();
 
 private:
     Ui::MainWindow *ui;
@@ -58,6 +61,8 @@ private:
     int             viewScreen_index;
     int             menuScreen_index;
     int             addScreen_index;
+
+    bool            closing_flag;
 };
 
 #endif // MAINWINDOW_H
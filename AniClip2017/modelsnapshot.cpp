@@ -0,0 +1,122 @@
+#include "modelsnapshot.h"
+#include "clipdatabase.h"
+
+#include <QIODevice>
+#include <QTextStream>
+#include <QDateTime>
+
+ModelSnapshot::ModelSnapshot(ClipDatabase *db) :
+    stringPool(*db->getStringPool()),
+    clipStore(*db->getClipStore(), &stringPool),
+    mainList(),
+    subLists(),
+    shows(db->existingShows),
+    tagGroups(),
+    clips_filename(db->clips_filename),
+    shows_filename(db->shows_filename),
+    tags_filename(db->tags_filename),
+    snapshot_flag(db->snapshot_flag),
+    backupRecent(db->backupRecent),
+    backupDaily(db->backupDaily),
+    backupWeekly(db->backupWeekly),
+    backupFullEvery(db->backupFullEvery),
+    journalSegment(-1)
+{
+    mainList = copyList(db->main_list);
+
+    subLists.reserve(db->sub_lists.count());
+    for (int i = 0; i < db->sub_lists.count(); i++) {
+        subLists.append(copyList(db->sub_lists.at(i)));
+    }
+
+    TagManager *tagManager = db->getTagManager();
+    tagGroups.reserve(tagManager->groups.count());
+    for (int i = 0; i < tagManager->groups.count(); i++) {
+        TagGroupSnapshot nGroup;
+        nGroup.nameId   = tagManager->groups.at(i)->getNameId();
+        nGroup.tags     = tagManager->groups.at(i)->getTagIds();
+        tagGroups.append(nGroup);
+    }
+}
+
+ListSnapshot ModelSnapshot::copyList(ClipList *nList) {
+    ListSnapshot rList;
+    rList.nameId = nList->listNameId;
+    rList.shows.reserve(nList->shows.count());
+
+    for (int i = 0; i < nList->shows.count(); i++) {
+        ShowSnapshot nShow;
+        nShow.showId    = nList->shows.at(i)->getShowId();
+        nShow.clips     = nList->shows.at(i)->clips;
+        rList.shows.append(nShow);
+    }
+
+    return rList;
+}
+
+void ModelSnapshot::writeList(QTextStream &nStream, const ListSnapshot &nList) const {
+
+    nStream << "List::" << stringPool.string(nList.nameId) << endl << "{" << endl << endl;
+
+    for (int i = 0; i < nList.shows.count(); i++) {
+        const ShowSnapshot &cShow = nList.shows.at(i);
+
+        nStream << "\t#" << stringPool.string(cShow.showId) << endl;
+        for (int j = 0; j < cShow.clips.count(); j++) {
+            nStream << "\t";
+            clipStore.writeClipToFile(nStream, cShow.clips.at(j));
+        }
+        nStream << endl;
+    }
+
+    nStream << "}" << endl << endl;
+}
+
+void ModelSnapshot::writeClips(QIODevice *nDevice) const {
+    QTextStream out(nDevice);
+    out.setCodec("UTF-8");
+
+    out << "#ClipList | " << QDateTime::currentDateTime().toString("dd MMM YYYY mm:ss") << endl;
+
+    writeList(out, mainList);
+
+    for (int i = 0; i < subLists.count(); i++) {
+        writeList(out, subLists.at(i));
+    }
+
+    out.flush();
+}
+
+void ModelSnapshot::writeShows(QIODevice *nDevice) const {
+    QTextStream out(nDevice);
+    out.setCodec("UTF-8");
+
+    out << "#ShowList | " << QDateTime::currentDateTime().toString("dd MMM YYYY mm:ss") << endl;
+    for (int i = 0; i < shows.count(); i++) {
+        out << shows.at(i) << endl;
+    }
+
+    out.flush();
+}
+
+void ModelSnapshot::writeTags(QIODevice *nDevice) const {
+    QTextStream out(nDevice);
+    out.setCodec("UTF-8");
+
+    out << "#TagList | " << QDateTime::currentDateTime().toString("dd MMM YYYY mm:ss") << endl << endl;
+
+    for (int i = 0; i < tagGroups.count(); i++) {
+        out << "name=" << stringPool.string(tagGroups.at(i).nameId) << ":tags=";
+        out << stringPool.strings(tagGroups.at(i).tags).join("|") << endl;
+    }
+
+    out.flush();
+}
+
+int ModelSnapshot::getClipCount() const {
+    int rCount = 0;
+    for (int i = 0; i < mainList.shows.count(); i++) {
+        rCount += mainList.shows.at(i).clips.count();
+    }
+    return rCount;
+}
@@ -0,0 +1,73 @@
+#ifndef MODELSNAPSHOT_H
+#define MODELSNAPSHOT_H
+
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+#include "stringpool.h"
+#include "clipstore.h"
+
+class QIODevice;
+class QTextStream;
+class ClipDatabase;
+class ClipList;
+
+struct ShowSnapshot {
+    int          showId;
+    QVector<int> clips;
+};
+
+struct ListSnapshot {
+    int                   nameId;
+    QVector<ShowSnapshot> shows;
+};
+
+struct TagGroupSnapshot {
+    int          nameId;
+    QVector<int> tags;
+};
+
+// Read only copy of everything a save writes. All containers are implicitly
+// shared with the live model, so taking one on the GUI thread costs a few
+// reference count bumps per list and show; the data is only copied if the
+// model changes while the writer thread still holds the snapshot.
+class ModelSnapshot
+{
+public:
+    explicit ModelSnapshot(ClipDatabase *db);
+
+    void writeClips(QIODevice *nDevice) const;
+    void writeShows(QIODevice *nDevice) const;
+    void writeTags(QIODevice *nDevice) const;
+
+    int getClipCount() const;
+
+    StringPool stringPool;
+    ClipStore clipStore;
+
+    ListSnapshot mainList;
+    QVector<ListSnapshot> subLists;
+    QStringList shows;
+    QVector<TagGroupSnapshot> tagGroups;
+
+    QString clips_filename;
+    QString shows_filename;
+    QString tags_filename;
+
+    bool snapshot_flag;
+    int backupRecent;
+    int backupDaily;
+    int backupWeekly;
+    int backupFullEvery;
+
+    int journalSegment;
+
+private:
+    Q_DISABLE_COPY(ModelSnapshot)
+
+    static ListSnapshot copyList(ClipList *nList);
+    void writeList(QTextStream &nStream, const ListSnapshot &nList) const;
+};
+
+#endif // MODELSNAPSHOT_H
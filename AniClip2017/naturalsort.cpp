@@ -0,0 +1,61 @@
+#include "naturalsort.h"
+#include "stringpool.h"
+
+static const char KEY_TEXT   = 0x01;
+static const char KEY_NUMBER = 0x02;
+
+QByteArray naturalSortKey(const QString &nString) {
+    QByteArray rKey;
+    rKey.reserve(nString.length() * 3);
+
+    const QChar *cPos = nString.constData();
+    const QChar *cEnd = cPos + nString.length();
+
+    while (cPos < cEnd) {
+        if (cPos->isDigit()) {
+            while (cPos < cEnd && cPos->isDigit() && cPos->digitValue() == 0) {
+                cPos++;
+            }
+
+            const QChar *runStart = cPos;
+            while (cPos < cEnd && cPos->isDigit()) {
+                cPos++;
+            }
+
+            int numDigits = qMin<int>(cPos - runStart, 255);
+            rKey.append(KEY_NUMBER);
+            rKey.append(static_cast<char>(numDigits));
+            for (int i = 0; i < numDigits; i++) {
+                rKey.append(static_cast<char>('0' + runStart[i].digitValue()));
+            }
+        }
+        else {
+            ushort folded = cPos->toCaseFolded().unicode();
+            rKey.append(KEY_TEXT);
+            rKey.append(static_cast<char>(folded >> 8));
+            rKey.append(static_cast<char>(folded & 0xFF));
+            cPos++;
+        }
+    }
+
+    return rKey;
+}
+
+bool naturalLessThan(const QString &s1, const QString &s2) {
+    return naturalSortKey(s1) < naturalSortKey(s2);
+}
+
+bool SortKeyLessThan::operator()(int t1, int t2) const {
+    const QByteArray &k1 = stringPool->sortKey(t1);
+    const QByteArray &k2 = stringPool->sortKey(t2);
+
+    bool rFlag = false;
+    if (k1 != k2) {
+        rFlag = k1 < k2;
+    }
+    else {
+        rFlag = stringPool->string(t1) < stringPool->string(t2);
+    }
+
+    return rFlag;
+}
@@ -0,0 +1,30 @@
+#ifndef NATURALSORT_H
+#define NATURALSORT_H
+
+#include <QString>
+#include <QByteArray>
+
+class StringPool;
+
+// Natural order collation key. Comparing two keys bytewise gives the same
+// order as comparing the strings case insensitively with runs of digits
+// compared by value, so "Tag9" sorts before "Tag10". Text sorts before a
+// number at the same position and a prefix sorts before the longer string.
+//
+// Each character becomes 0x01 followed by its case folded UTF-16 code unit,
+// high byte first. Each digit run becomes 0x02, the number of significant
+// digits and then the digits themselves.
+QByteArray naturalSortKey(const QString &nString);
+
+bool naturalLessThan(const QString &s1, const QString &s2);
+
+// Orders pooled string ids by their cached natural sort keys. Strings that
+// only differ in case or leading zeros fall back to a plain comparison so the
+// order stays total.
+struct SortKeyLessThan {
+    StringPool *stringPool;
+
+    bool operator()(int t1, int t2) const;
+};
+
+#endif // NATURALSORT_H
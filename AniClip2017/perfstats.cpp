@@ -0,0 +1,134 @@
+#include "perfstats.h"
+
+#include <QByteArray>
+#include <QHash>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QElapsedTimer>
+#include <QVector>
+#include <QtAlgorithms>
+
+using namespace logger;
+
+namespace {
+
+struct Samples {
+    Samples() : window(), next(0), count(0), last(0), lastAt(0) {}
+
+    QVector<qint64> window;
+    int             next;
+    int             count;
+    qint64          last;
+    qint64          lastAt;
+};
+
+// Samples of one thread. Only its thread adds; the lock is there for
+// summary(), so it is never contended while recording.
+struct ThreadStats {
+    QMutex                      mutex;
+    QHash<QByteArray, Samples>  stats;
+};
+
+// Like the trace buffers, these outlive their threads.
+QMutex threadsMutex;
+QVector<ThreadStats*> threads;
+thread_local ThreadStats *localStats = NULL;
+
+ThreadStats *threadStats() {
+    if (localStats == NULL) {
+        ThreadStats *nStats = new ThreadStats;
+
+        QMutexLocker locker(&threadsMutex);
+        threads.append(nStats);
+        localStats = nStats;
+    }
+
+    return localStats;
+}
+
+QElapsedTimer startedClock() {
+    QElapsedTimer rClock;
+    rClock.start();
+    return rClock;
+}
+
+// Orders the last sample of each thread.
+qint64 now() {
+    static QElapsedTimer statsClock = startedClock();
+    return statsClock.nsecsElapsed();
+}
+
+qint64 percentile(const QVector<qint64> &nSorted, int nPercent) {
+    return nSorted.at(qMin(nSorted.count() - 1, nSorted.count() * nPercent / 100));
+}
+
+}
+
+PerfStats::Summary::Summary() :
+    count(0),
+    lastNsecs(0),
+    p50Nsecs(0),
+    p90Nsecs(0),
+    p99Nsecs(0),
+    maxNsecs(0)
+{
+
+}
+
+// The key is only copied the first time a thread sees a name.
+void PerfStats::add(const char *nName, qint64 nNsecs) {
+    ThreadStats *cStats = threadStats();
+    QMutexLocker locker(&cStats->mutex);
+
+    QHash<QByteArray, Samples>::iterator found = cStats->stats.find(QByteArray::fromRawData(nName, qstrlen(nName)));
+    if (found == cStats->stats.end()) {
+        found = cStats->stats.insert(QByteArray(nName), Samples());
+    }
+    Samples &cSamples = found.value();
+
+    if (cSamples.window.count() < windowSize) {
+        cSamples.window.append(nNsecs);
+    }
+    else {
+        cSamples.window[cSamples.next] = nNsecs;
+    }
+    cSamples.next = (cSamples.next + 1) % windowSize;
+    cSamples.count++;
+    cSamples.last = nNsecs;
+    cSamples.lastAt = now();
+}
+
+// Merges the windows of every thread. Percentiles are over the kept
+// windows; count is every sample ever added.
+PerfStats::Summary PerfStats::summary(const char *nName) {
+    Summary rSummary;
+    QVector<qint64> sorted;
+    qint64 lastAt = -1;
+    QByteArray key = QByteArray::fromRawData(nName, qstrlen(nName));
+
+    threadsMutex.lock();
+    for (int i = 0; i < threads.count(); i++) {
+        QMutexLocker locker(&threads.at(i)->mutex);
+        QHash<QByteArray, Samples>::const_iterator it = threads.at(i)->stats.constFind(key);
+
+        if (it != threads.at(i)->stats.constEnd()) {
+            sorted += it.value().window;
+            rSummary.count += it.value().count;
+            if (it.value().lastAt > lastAt) {
+                lastAt = it.value().lastAt;
+                rSummary.lastNsecs = it.value().last;
+            }
+        }
+    }
+    threadsMutex.unlock();
+
+    if (!sorted.isEmpty()) {
+        qSort(sorted);
+        rSummary.p50Nsecs = percentile(sorted, 50);
+        rSummary.p90Nsecs = percentile(sorted, 90);
+        rSummary.p99Nsecs = percentile(sorted, 99);
+        rSummary.maxNsecs = sorted.last();
+    }
+
+    return rSummary;
+}
@@ -0,0 +1,34 @@
+#ifndef PERFSTATS_H
+#define PERFSTATS_H
+
+#include <QString>
+
+namespace logger {
+
+// Recent durations per name, for the live counters in DebugWidget. Every
+// TraceSpan reports here whether or not tracing is on, so names are span
+// names. Each thread keeps its own last windowSize samples of each name, so
+// recording never contends; summary() merges them.
+class PerfStats
+{
+public:
+    struct Summary {
+        Summary();
+
+        int     count;
+        qint64  lastNsecs;
+        qint64  p50Nsecs;
+        qint64  p90Nsecs;
+        qint64  p99Nsecs;
+        qint64  maxNsecs;
+    };
+
+    static void add(const char *nName, qint64 nNsecs);
+    static Summary summary(const char *nName);
+
+    static const int windowSize = 256;
+};
+
+}
+
+#endif // PERFSTATS_H
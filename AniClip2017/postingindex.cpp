@@ -0,0 +1,199 @@
+#include "postingindex.h"
+
+#include <QtAlgorithms>
+
+PostingIndex::PostingIndex() :
+    index(),
+    empty()
+{
+
+}
+
+void PostingIndex::addClip(int nClipId, const QVector<int> &nKeys) {
+    for (int i = 0; i < nKeys.count(); i++) {
+        QVector<int> &cList = index[nKeys.at(i)];
+
+        if (cList.isEmpty() || cList.last() < nClipId) {
+            cList.append(nClipId);
+        }
+        else {
+            QVector<int>::iterator found = qLowerBound(cList.begin(), cList.end(), nClipId);
+            if (found == cList.end() || *found != nClipId) {
+                cList.insert(found, nClipId);
+            }
+        }
+    }
+}
+
+void PostingIndex::addClip(int nClipId, int nKey) {
+    addClip(nClipId, QVector<int>(1, nKey));
+}
+
+void PostingIndex::removeClip(int nClipId, const QVector<int> &nKeys) {
+    for (int i = 0; i < nKeys.count(); i++) {
+        QHash<int, QVector<int> >::iterator cList = index.find(nKeys.at(i));
+
+        if (cList != index.end()) {
+            QVector<int>::iterator found = qLowerBound(cList->begin(), cList->end(), nClipId);
+            if (found != cList->end() && *found == nClipId) {
+                cList->erase(found);
+            }
+
+            if (cList->isEmpty()) {
+                index.erase(cList);
+            }
+        }
+    }
+}
+
+void PostingIndex::removeClip(int nClipId, int nKey) {
+    removeClip(nClipId, QVector<int>(1, nKey));
+}
+
+void PostingIndex::clear() {
+    index.clear();
+}
+
+const QVector<int> &PostingIndex::postings(int nKey) const {
+    QHash<int, QVector<int> >::const_iterator found = index.constFind(nKey);
+    return found != index.constEnd() ? found.value() : empty;
+}
+
+int PostingIndex::count(int nKey) const {
+    return postings(nKey).count();
+}
+
+QList<int> PostingIndex::keys() const {
+    return index.keys();
+}
+
+// Intersects from the shortest list up, so the result can only shrink.
+QVector<int> PostingIndex::matchAll(const QVector<int> &nKeys) const {
+    QVector<int> rIds;
+
+    if (!nKeys.isEmpty()) {
+        QVector<const QVector<int>*> lists;
+        lists.reserve(nKeys.count());
+
+        for (int i = 0; i < nKeys.count(); i++) {
+            const QVector<int> *cList = &postings(nKeys.at(i));
+            int j = lists.count();
+            while (j > 0 && lists.at(j - 1)->count() > cList->count()) {
+                j--;
+            }
+            lists.insert(j, cList);
+        }
+
+        rIds = *lists.at(0);
+        for (int i = 1; i < lists.count() && !rIds.isEmpty(); i++) {
+            rIds = intersect(rIds, *lists.at(i));
+        }
+    }
+
+    return rIds;
+}
+
+QVector<int> PostingIndex::matchAny(const QVector<int> &nKeys) const {
+    QVector<int> rIds;
+
+    for (int i = 0; i < nKeys.count(); i++) {
+        rIds = unite(rIds, postings(nKeys.at(i)));
+    }
+
+    return rIds;
+}
+
+// When one list is much shorter, each of its ids is looked up in the other by
+// galloping ahead from the last match; otherwise both lists are walked.
+QVector<int> PostingIndex::intersect(const QVector<int> &a, const QVector<int> &b) {
+    const QVector<int> &small = a.count() <= b.count() ? a : b;
+    const QVector<int> &large = a.count() <= b.count() ? b : a;
+    QVector<int> rIds;
+    rIds.reserve(small.count());
+
+    if (small.count() * 16 < large.count()) {
+        QVector<int>::const_iterator cPos = large.constBegin();
+
+        for (int i = 0; i < small.count() && cPos != large.constEnd(); i++) {
+            int step = 1;
+            QVector<int>::const_iterator cEnd = cPos;
+            while (cEnd != large.constEnd() && *cEnd < small.at(i)) {
+                cPos = cEnd;
+                cEnd = (large.constEnd() - cEnd > step) ? cEnd + step : large.constEnd();
+                step *= 2;
+            }
+
+            cPos = qLowerBound(cPos, cEnd, small.at(i));
+            if (cPos != large.constEnd() && *cPos == small.at(i)) {
+                rIds.append(small.at(i));
+            }
+        }
+    }
+    else {
+        int i = 0;
+        int j = 0;
+        while (i < small.count() && j < large.count()) {
+            if (small.at(i) < large.at(j)) {
+                i++;
+            }
+            else if (large.at(j) < small.at(i)) {
+                j++;
+            }
+            else {
+                rIds.append(small.at(i));
+                i++;
+                j++;
+            }
+        }
+    }
+
+    return rIds;
+}
+
+QVector<int> PostingIndex::unite(const QVector<int> &a, const QVector<int> &b) {
+    QVector<int> rIds;
+
+    if (a.isEmpty()) {
+        rIds = b;
+    }
+    else if (b.isEmpty()) {
+        rIds = a;
+    }
+    else {
+        rIds.reserve(a.count() + b.count());
+
+        int i = 0;
+        int j = 0;
+        while (i < a.count() || j < b.count()) {
+            if (j == b.count() || (i < a.count() && a.at(i) < b.at(j))) {
+                rIds.append(a.at(i++));
+            }
+            else if (i == a.count() || b.at(j) < a.at(i)) {
+                rIds.append(b.at(j++));
+            }
+            else {
+                rIds.append(a.at(i));
+                i++;
+                j++;
+            }
+        }
+    }
+
+    return rIds;
+}
+
+bool PostingIndex::containsId(const QVector<int> &nIds, int nClipId) {
+    return qBinaryFind(nIds.constBegin(), nIds.constEnd(), nClipId) != nIds.constEnd();
+}
+
+qint64 PostingIndex::memoryUsage() const {
+    qint64 rBytes = index.capacity() * sizeof(void*);
+
+    QHash<int, QVector<int> >::const_iterator cList = index.constBegin();
+    for (; cList != index.constEnd(); ++cList) {
+        rBytes += sizeof(void*) + sizeof(uint) + sizeof(int) + sizeof(QVector<int>);
+        rBytes += cList.value().capacity() * sizeof(int);
+    }
+
+    return rBytes;
+}
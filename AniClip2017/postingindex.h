@@ -0,0 +1,40 @@
+#ifndef POSTINGINDEX_H
+#define POSTINGINDEX_H
+
+#include <QVector>
+#include <QHash>
+
+// Inverted index from a key (tag, show, year or season id) to the ids of the
+// clips carrying it. Each posting list is a sorted vector of clip ids. Clip
+// ids only grow, so adding a new clip appends to the end of its lists; only
+// edits insert mid list.
+class PostingIndex
+{
+public:
+    PostingIndex();
+
+    void addClip(int nClipId, const QVector<int> &nKeys);
+    void addClip(int nClipId, int nKey);
+    void removeClip(int nClipId, const QVector<int> &nKeys);
+    void removeClip(int nClipId, int nKey);
+    void clear();
+
+    const QVector<int> &postings(int nKey) const;
+    int count(int nKey) const;
+    QList<int> keys() const;
+
+    QVector<int> matchAll(const QVector<int> &nKeys) const;
+    QVector<int> matchAny(const QVector<int> &nKeys) const;
+
+    static QVector<int> intersect(const QVector<int> &a, const QVector<int> &b);
+    static QVector<int> unite(const QVector<int> &a, const QVector<int> &b);
+    static bool containsId(const QVector<int> &nIds, int nClipId);
+
+    qint64 memoryUsage() const;
+
+private:
+    QHash<int, QVector<int> > index;
+    QVector<int> empty;
+};
+
+#endif // POSTINGINDEX_H
@@ -0,0 +1,75 @@
+#include "rowdiff.h"
+
+#include <QSet>
+
+RowDiff::RowDiff() :
+    removed(),
+    inserted(),
+    reordered_flag(false)
+{
+
+}
+
+bool RowDiff::isEmpty() const {
+    return removed.isEmpty() && inserted.isEmpty() && !reordered_flag;
+}
+
+static void appendRow(QVector<RowRange> &rRanges, int nRow) {
+    if (!rRanges.isEmpty() && rRanges.last().last + 1 == nRow) {
+        rRanges.last().last = nRow;
+    }
+    else {
+        RowRange nRange;
+        nRange.first = nRow;
+        nRange.last = nRow;
+        rRanges.append(nRange);
+    }
+}
+
+RowDiff diffRows(const QVector<int> &oldKeys, const QVector<int> &newKeys) {
+    RowDiff rDiff;
+
+    if (oldKeys != newKeys) {
+        QSet<int> oldSet;
+        QSet<int> newSet;
+        oldSet.reserve(oldKeys.count());
+        newSet.reserve(newKeys.count());
+        for (int i = 0; i < oldKeys.count(); i++) {
+            oldSet.insert(oldKeys.at(i));
+        }
+        for (int i = 0; i < newKeys.count(); i++) {
+            newSet.insert(newKeys.at(i));
+        }
+
+        QVector<int> kept;
+        kept.reserve(oldKeys.count());
+        for (int i = 0; i < oldKeys.count(); i++) {
+            if (newSet.contains(oldKeys.at(i))) {
+                kept.append(oldKeys.at(i));
+            }
+            else {
+                appendRow(rDiff.removed, i);
+            }
+        }
+
+        int k = 0;
+        for (int i = 0; i < newKeys.count() && !rDiff.reordered_flag; i++) {
+            if (k < kept.count() && kept.at(k) == newKeys.at(i)) {
+                k++;
+            }
+            else if (oldSet.contains(newKeys.at(i))) {
+                rDiff.reordered_flag = true;
+            }
+            else {
+                appendRow(rDiff.inserted, i);
+            }
+        }
+
+        // Removals are applied from the bottom up.
+        for (int i = 0; i < rDiff.removed.count() / 2; i++) {
+            qSwap(rDiff.removed[i], rDiff.removed[rDiff.removed.count() - 1 - i]);
+        }
+    }
+
+    return rDiff;
+}
@@ -0,0 +1,28 @@
+#ifndef ROWDIFF_H
+#define ROWDIFF_H
+
+#include <QVector>
+
+struct RowRange {
+    int first;
+    int last;
+};
+
+// Edit script turning one sequence of row keys into another. Apply the
+// removals first, in the order given (last rows first, so earlier ranges stay
+// valid), then the insertions, which are rows of the new sequence in
+// ascending order. If rows that survive changed their relative order the
+// script cannot express it and reordered_flag is set instead.
+struct RowDiff {
+    QVector<RowRange> removed;
+    QVector<RowRange> inserted;
+    bool reordered_flag;
+
+    RowDiff();
+
+    bool isEmpty() const;
+};
+
+RowDiff diffRows(const QVector<int> &oldKeys, const QVector<int> &newKeys);
+
+#endif // ROWDIFF_H
@@ -0,0 +1,197 @@
+#include "savethread.h"
+#include "modelsnapshot.h"
+#include "savetransaction.h"
+#include "clipsnapshot.h"
+#include "backupstore.h"
+#include "clipjournal.h"
+#include "logger.h"
+#include "tracer.h"
+
+#include <QDir>
+#include <QMutexLocker>
+#include <QElapsedTimer>
+
+SaveThread::SaveThread(logger::Logger *nLog, QObject *parent) : QThread(parent),
+    log(nLog),
+    mutex(),
+    queued(),
+    idle(),
+    pending(NULL),
+    busy_flag(false),
+    stop_flag(false),
+    committedSegment(-1),
+    backupChain_flag(false)
+{
+
+}
+
+SaveThread::~SaveThread() {
+    stop();
+    wait();
+    delete pending;
+}
+
+void SaveThread::enqueue(ModelSnapshot *nSnapshot) {
+    QMutexLocker locker(&mutex);
+
+    if (pending != NULL) {
+        // Still waiting, so the newer snapshot covers it. Keep the older
+        // journal segment so the newer save drops both.
+        nSnapshot->journalSegment = qMax(nSnapshot->journalSegment, pending->journalSegment);
+        delete pending;
+        log->info("SaveThread.enqueue: Coalesced with pending save.");
+    }
+    pending = nSnapshot;
+
+    queued.wakeOne();
+}
+
+void SaveThread::waitForIdle() {
+    QMutexLocker locker(&mutex);
+
+    while (pending != NULL || busy_flag) {
+        idle.wait(&mutex);
+    }
+}
+
+// Finishes any queued save before the thread exits.
+void SaveThread::stop() {
+    QMutexLocker locker(&mutex);
+
+    stop_flag = true;
+    queued.wakeOne();
+}
+
+bool SaveThread::isBusy() {
+    QMutexLocker locker(&mutex);
+    return pending != NULL || busy_flag;
+}
+
+int SaveThread::getCommittedSegment() {
+    QMutexLocker locker(&mutex);
+    return committedSegment;
+}
+
+void SaveThread::run() {
+    bool running_flag = true;
+
+    while (running_flag) {
+        ModelSnapshot *cSnapshot = NULL;
+
+        mutex.lock();
+        while (pending == NULL && !stop_flag) {
+            queued.wait(&mutex);
+        }
+
+        if (pending != NULL) {
+            cSnapshot = pending;
+            pending = NULL;
+            busy_flag = true;
+        }
+        else {
+            running_flag = false;
+        }
+        mutex.unlock();
+
+        if (cSnapshot != NULL) {
+            emit saveStarted();
+            bool saveSuccess_flag = writeSnapshot(*cSnapshot);
+            int segment = cSnapshot->journalSegment;
+            delete cSnapshot;
+
+            mutex.lock();
+            if (saveSuccess_flag && segment > committedSegment) {
+                committedSegment = segment;
+            }
+            busy_flag = false;
+            if (pending == NULL) {
+                idle.wakeAll();
+            }
+            mutex.unlock();
+
+            emit saveFinished(saveSuccess_flag, segment);
+        }
+    }
+
+    mutex.lock();
+    idle.wakeAll();
+    mutex.unlock();
+}
+
+// The clip, show and tag files are replaced together or not at all. The
+// snapshot and backup only happen once the new files are in place.
+bool SaveThread::writeSnapshot(const ModelSnapshot &nSnapshot) {
+    logger::TraceSpan span("SaveThread.writeSnapshot");
+    bool saveSuccess_flag = false;
+    QElapsedTimer timer;
+    timer.start();
+
+    SaveTransaction transaction(log, nSnapshot.clips_filename + ".commit");
+    QIODevice *clipFile = transaction.stage(nSnapshot.clips_filename);
+    QIODevice *showFile = transaction.stage(nSnapshot.shows_filename);
+    QIODevice *tagsFile = transaction.stage(nSnapshot.tags_filename);
+
+    if (clipFile != NULL && showFile != NULL && tagsFile != NULL) {
+        emit saveProgress(0, QString("Writing %1").arg(nSnapshot.clips_filename));
+        nSnapshot.writeClips(clipFile);
+
+        emit saveProgress(40, QString("Writing %1").arg(nSnapshot.shows_filename));
+        nSnapshot.writeShows(showFile);
+
+        emit saveProgress(45, QString("Writing %1").arg(nSnapshot.tags_filename));
+        nSnapshot.writeTags(tagsFile);
+
+        emit saveProgress(50, "Committing");
+        saveSuccess_flag = transaction.commit();
+    }
+
+    if (saveSuccess_flag) {
+        if (nSnapshot.snapshot_flag) {
+            emit saveProgress(60, "Writing snapshot");
+            ClipSnapshot snapshot(log);
+            if (!snapshot.write(nSnapshot, nSnapshot.clips_filename)) {
+                log->warn(QString("Unable to write snapshot for %1.").arg(nSnapshot.clips_filename));
+            }
+        }
+
+        emit saveProgress(80, "Writing backup");
+        BackupStore store(log, QDir::currentPath() + "/backup");
+        store.setRetention(nSnapshot.backupRecent, nSnapshot.backupDaily, nSnapshot.backupWeekly);
+        store.setFullInterval(nSnapshot.backupFullEvery);
+
+        // The segments not yet dropped hold every change since the previous
+        // save. Only the previous backup of this session is known to be that
+        // save, so the first backup after a start or a failure is a full one.
+        QStringList filenames = QStringList() << nSnapshot.clips_filename << nSnapshot.tags_filename << nSnapshot.shows_filename;
+        QString generation;
+
+        if (backupChain_flag && nSnapshot.journalSegment != -1) {
+            QStringList segment_filenames;
+            QVector<int> segments = ClipJournal::segments(nSnapshot.clips_filename);
+            for (int i = 0; i < segments.count() && segments.at(i) <= nSnapshot.journalSegment; i++) {
+                segment_filenames.append(ClipJournal::segmentFilename(nSnapshot.clips_filename, segments.at(i)));
+            }
+
+            generation = store.backupIncremental(filenames, nSnapshot.clips_filename, segment_filenames);
+        }
+        else {
+            generation = store.backup(filenames);
+        }
+
+        backupChain_flag = !generation.isEmpty();
+        if (backupChain_flag) {
+            store.prune();
+        }
+        else {
+            log->err("SaveThread.writeSnapshot: Backup failed.");
+        }
+
+        emit saveProgress(100, "Saved");
+        log->info(QString("Saved %1 clips in %2 ms.").arg(nSnapshot.getClipCount()).arg(timer.elapsed()));
+    }
+    else {
+        log->err("SaveThread.writeSnapshot: Save failed. Existing files were left unchanged.");
+    }
+
+    return saveSuccess_flag;
+}
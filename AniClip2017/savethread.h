@@ -0,0 +1,58 @@
+#ifndef SAVETHREAD_H
+#define SAVETHREAD_H
+
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QString>
+
+namespace logger {
+class Logger;
+}
+
+class ModelSnapshot;
+
+// Writer thread for ClipDatabase saves. Each request hands over a
+// ModelSnapshot; if a request arrives while another is still queued, the
+// older one is dropped, since the newer snapshot already contains it.
+class SaveThread : public QThread
+{
+    Q_OBJECT
+public:
+    explicit SaveThread(logger::Logger *nLog, QObject *parent = 0);
+    ~SaveThread();
+
+    void enqueue(ModelSnapshot *nSnapshot);
+    void waitForIdle();
+    void stop();
+
+    bool isBusy();
+    int getCommittedSegment();
+
+signals:
+    void saveStarted();
+    void saveProgress(int nPercent, const QString &nStage);
+    void saveFinished(bool nSuccess, int nSegment);
+
+protected:
+    void run();
+
+private:
+    bool writeSnapshot(const ModelSnapshot &nSnapshot);
+
+    logger::Logger *log;
+
+    QMutex mutex;
+    QWaitCondition queued;
+    QWaitCondition idle;
+
+    ModelSnapshot *pending;
+    bool busy_flag;
+    bool stop_flag;
+    int committedSegment;
+
+    // The newest backup holds this thread's last save.
+    bool backupChain_flag;
+};
+
+#endif // SAVETHREAD_H
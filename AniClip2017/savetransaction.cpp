@@ -0,0 +1,176 @@
+#include "savetransaction.h"
+#include "logger.h"
+
+#include <QFile>
+#include <QFileInfo>
+#include <QTextStream>
+#include <QtAlgorithms>
+
+#ifdef Q_OS_WIN
+#include <windows.h>
+#else
+#include <stdio.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+SaveTransaction::SaveTransaction(logger::Logger *nLog, QString marker_filename) :
+    log(nLog),
+    markerFilename(marker_filename),
+    filenames(),
+    files()
+{
+
+}
+
+SaveTransaction::~SaveTransaction() {
+    // QSaveFile drops its temp file when deleted without commit().
+    qDeleteAll(files);
+}
+
+QIODevice* SaveTransaction::stage(QString filename, QIODevice::OpenMode nMode) {
+    QSaveFile *rFile = new QSaveFile(tempFilename(filename));
+
+    if (rFile->open(nMode)) {
+        filenames.append(filename);
+        files.append(rFile);
+    }
+    else {
+        log->err(QString("SaveTransaction.stage: Unable to open \"%1\". %2").arg(rFile->fileName()).arg(rFile->errorString()));
+        delete rFile;
+        rFile = NULL;
+    }
+
+    return rFile;
+}
+
+bool SaveTransaction::commit() {
+    bool commitSuccess_flag = !files.isEmpty();
+
+    for (int i = 0; i < files.count() && commitSuccess_flag; i++) {
+        if (!files.at(i)->commit()) {
+            log->err(QString("SaveTransaction.commit: Failed to write \"%1\". %2").arg(files.at(i)->fileName()).arg(files.at(i)->errorString()));
+            commitSuccess_flag = false;
+        }
+    }
+
+    if (commitSuccess_flag) {
+        QSaveFile marker(markerFilename);
+        if (marker.open(QIODevice::WriteOnly | QIODevice::Text)) {
+            QTextStream out(&marker);
+            out.setCodec("UTF-8");
+            for (int i = 0; i < filenames.count(); i++) {
+                out << filenames.at(i) << endl;
+            }
+            out.flush();
+            commitSuccess_flag = marker.commit();
+        }
+        else {
+            commitSuccess_flag = false;
+        }
+
+        if (!commitSuccess_flag) {
+            log->err(QString("SaveTransaction.commit: Failed to write marker \"%1\". %2").arg(markerFilename).arg(marker.errorString()));
+        }
+    }
+
+    if (commitSuccess_flag) {
+        commitSuccess_flag = finish(log, markerFilename, filenames);
+    }
+    else {
+        for (int i = 0; i < filenames.count(); i++) {
+            QFile::remove(tempFilename(filenames.at(i)));
+        }
+    }
+
+    return commitSuccess_flag;
+}
+
+bool SaveTransaction::recover(logger::Logger *nLog, QString marker_filename, QStringList filenames) {
+    bool recoverSuccess_flag = true;
+    QFile marker(marker_filename);
+
+    if (marker.exists()) {
+        QStringList staged;
+
+        if (marker.open(QIODevice::ReadOnly | QIODevice::Text)) {
+            QTextStream in(&marker);
+            in.setCodec("UTF-8");
+            while (!in.atEnd()) {
+                QString line = in.readLine();
+                if (!line.isEmpty()) {
+                    staged.append(line);
+                }
+            }
+            marker.close();
+
+            nLog->warn(QString("SaveTransaction.recover: Completing interrupted save of %1 files.").arg(staged.count()));
+            recoverSuccess_flag = finish(nLog, marker_filename, staged);
+        }
+        else {
+            nLog->err(QString("SaveTransaction.recover: Unable to read marker \"%1\". %2").arg(marker_filename).arg(marker.errorString()));
+            recoverSuccess_flag = false;
+        }
+    }
+    else {
+        for (int i = 0; i < filenames.count(); i++) {
+            if (QFile::exists(tempFilename(filenames.at(i)))) {
+                nLog->warn(QString("SaveTransaction.recover: Discarding incomplete \"%1\".").arg(tempFilename(filenames.at(i))));
+                QFile::remove(tempFilename(filenames.at(i)));
+            }
+        }
+    }
+
+    return recoverSuccess_flag;
+}
+
+QString SaveTransaction::tempFilename(QString filename) {
+    return filename + ".tmp";
+}
+
+bool SaveTransaction::replaceFile(QString from_filename, QString to_filename) {
+#ifdef Q_OS_WIN
+    return MoveFileExW(reinterpret_cast<LPCWSTR>(from_filename.utf16()), reinterpret_cast<LPCWSTR>(to_filename.utf16()),
+                       MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+#else
+    return ::rename(QFile::encodeName(from_filename).constData(), QFile::encodeName(to_filename).constData()) == 0;
+#endif
+}
+
+// Makes the renames themselves durable. Windows has no directory handle to
+// sync; MOVEFILE_WRITE_THROUGH covers it there.
+bool SaveTransaction::syncDirectory(QString filename) {
+    bool rFlag = true;
+#ifndef Q_OS_WIN
+    int fd = ::open(QFile::encodeName(QFileInfo(filename).absolutePath()).constData(), O_RDONLY);
+    if (fd >= 0) {
+        rFlag = (::fsync(fd) == 0);
+        ::close(fd);
+    }
+    else {
+        rFlag = false;
+    }
+#else
+    Q_UNUSED(filename);
+#endif
+    return rFlag;
+}
+
+bool SaveTransaction::finish(logger::Logger *nLog, QString marker_filename, QStringList filenames) {
+    bool finishSuccess_flag = true;
+
+    for (int i = 0; i < filenames.count(); i++) {
+        QString tFile = tempFilename(filenames.at(i));
+        if (QFile::exists(tFile) && !replaceFile(tFile, filenames.at(i))) {
+            nLog->err(QString("SaveTransaction.finish: Unable to replace \"%1\".").arg(filenames.at(i)));
+            finishSuccess_flag = false;
+        }
+    }
+
+    if (finishSuccess_flag) {
+        syncDirectory(marker_filename);
+        QFile::remove(marker_filename);
+    }
+
+    return finishSuccess_flag;
+}
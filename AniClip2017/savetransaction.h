@@ -0,0 +1,51 @@
+#ifndef SAVETRANSACTION_H
+#define SAVETRANSACTION_H
+
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <QSaveFile>
+
+namespace logger {
+class Logger;
+}
+
+// Writes a set of files so that either all of them or none of them replace
+// the live copies.
+//
+//  1. Every file is written to "<name>.tmp" through QSaveFile, which flushes
+//     and fsyncs before it renames into place.
+//  2. A marker file listing the staged files is written the same way. Once
+//     the marker exists the new generation is complete on disk.
+//  3. Each "<name>.tmp" is renamed over "<name>", then the marker is removed.
+//
+// If the process dies before step 2, recover() deletes the leftover temp files
+// and the old generation stays. If it dies during step 3, recover() finishes
+// the renames.
+class SaveTransaction
+{
+public:
+    SaveTransaction(logger::Logger *nLog, QString marker_filename);
+    ~SaveTransaction();
+
+    QIODevice* stage(QString filename, QIODevice::OpenMode nMode = QIODevice::WriteOnly | QIODevice::Text);
+    bool commit();
+
+    static bool recover(logger::Logger *nLog, QString marker_filename, QStringList filenames);
+
+private:
+    Q_DISABLE_COPY(SaveTransaction)
+
+    static QString tempFilename(QString filename);
+    static bool replaceFile(QString from_filename, QString to_filename);
+    static bool syncDirectory(QString filename);
+    static bool finish(logger::Logger *nLog, QString marker_filename, QStringList filenames);
+
+    logger::Logger *log;
+
+    QString markerFilename;
+    QStringList filenames;
+    QVector<QSaveFile*> files;
+};
+
+#endif // SAVETRANSACTION_H
@@ -0,0 +1,115 @@
+#include "searchcoordinator.h"
+#include "searchthread.h"
+#include "clipdatabase.h"
+#include "cliptreewidget.h"
+#include "tagtreewidget.h"
+#include "logger.h"
+#include "tracer.h"
+#include "perfstats.h"
+
+#include <QTimer>
+
+SearchCoordinator::SearchCoordinator(logger::Logger *nLog, QObject *parent) : QObject(parent),
+    log(nLog),
+    clipDB(NULL),
+    clipTree(NULL),
+    tagTree(NULL),
+    worker(NULL),
+    debounce(NULL),
+    clips_flag(false),
+    tags_flag(false),
+    tagSearch(),
+    generation(0),
+    requestTimer()
+{
+    worker = new SearchThread(log, this);
+    connect(worker, SIGNAL(resultReady()), this, SLOT(takeResult()));
+
+    debounce = new QTimer(this);
+    debounce->setSingleShot(true);
+    debounce->setInterval(150);
+    connect(debounce, SIGNAL(timeout()), this, SLOT(searchNow()));
+}
+
+SearchCoordinator::~SearchCoordinator() {
+    worker->stop();
+    worker->wait();
+}
+
+void SearchCoordinator::setClipDatabase(ClipDatabase *db) {
+    if (db != NULL) {
+        clipDB = db;
+        if (!worker->isRunning()) {
+            worker->start(QThread::LowPriority);
+        }
+    }
+}
+
+void SearchCoordinator::setClipTree(ClipTreeWidget *nTree) {
+    clipTree = nTree;
+}
+
+void SearchCoordinator::setTagTree(TagTreeWidget *nTree) {
+    tagTree = nTree;
+}
+
+void SearchCoordinator::setDelay(int nMsecs) {
+    debounce->setInterval(nMsecs);
+}
+
+void SearchCoordinator::searchTags(const QString &nSearch) {
+    tagSearch = nSearch;
+    tags_flag = tagTree != NULL;
+    debounce->start();
+}
+
+void SearchCoordinator::searchClips() {
+    clips_flag = clipTree != NULL;
+    debounce->start();
+}
+
+// Sends everything still waiting to the worker without further delay.
+void SearchCoordinator::searchNow() {
+    logger::TraceSpan span("SearchCoordinator.searchNow");
+    debounce->stop();
+
+    if (clipDB != NULL && (clips_flag || tags_flag)) {
+        SearchRequest *nRequest = new SearchRequest(clipDB);
+        nRequest->generation = ++generation;
+        nRequest->clips_flag = clips_flag;
+        nRequest->tags_flag = tags_flag;
+        nRequest->tagSearch = tagSearch;
+        if (clips_flag) {
+            nRequest->params = clipTree->getSearchParams();
+        }
+
+        worker->enqueue(nRequest);
+        requestTimer.start();
+    }
+}
+
+void SearchCoordinator::takeResult() {
+    SearchResult *cResult = worker->takeResult();
+
+    if (cResult != NULL && cResult->generation == generation) {
+        logger::PerfStats::add("SearchCoordinator.latency", requestTimer.nsecsElapsed());
+
+        if (cResult->clips_flag && clipTree != NULL) {
+            clips_flag = false;
+            clipTree->showResult(cResult->clips);
+
+            // Clips changed while the worker searched its copy.
+            if (cResult->clips.revision != clipDB->getClipStore()->getRevision()) {
+                log->trace("SearchCoordinator.takeResult: Clips changed during search, searching again.");
+                searchClips();
+            }
+        }
+
+        if (cResult->tags_flag && tagTree != NULL) {
+            tags_flag = false;
+            tagTree->showResult(cResult->tags);
+        }
+    }
+
+    delete cResult;
+}
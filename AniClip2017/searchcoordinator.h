@@ -0,0 +1,60 @@
+#ifndef SEARCHCOORDINATOR_H
+#define SEARCHCOORDINATOR_H
+
+#include <QObject>
+#include <QString>
+#include <QElapsedTimer>
+
+namespace logger {
+class Logger;
+}
+
+class QTimer;
+class ClipDatabase;
+class ClipTreeWidget;
+class TagTreeWidget;
+class SearchThread;
+
+// Feeds search input from the view screen to a SearchThread. Input is
+// collected until it has been quiet for the debounce delay, then sent as one
+// request; results that a newer request has overtaken are dropped.
+class SearchCoordinator : public QObject
+{
+    Q_OBJECT
+public:
+    explicit SearchCoordinator(logger::Logger *nLog, QObject *parent = 0);
+    ~SearchCoordinator();
+
+    void setClipDatabase(ClipDatabase *db);
+    void setClipTree(ClipTreeWidget *nTree);
+    void setTagTree(TagTreeWidget *nTree);
+    void setDelay(int nMsecs);
+
+public slots:
+    void searchTags(const QString &nSearch);
+    void searchClips();
+    void searchNow();
+
+private slots:
+    void takeResult();
+
+private:
+    logger::Logger *log;
+
+    ClipDatabase *clipDB;
+    ClipTreeWidget *clipTree;
+    TagTreeWidget *tagTree;
+
+    SearchThread *worker;
+    QTimer *debounce;
+
+    // Set until a result covering the latest input has been shown.
+    bool clips_flag;
+    bool tags_flag;
+    QString tagSearch;
+
+    int generation;
+    QElapsedTimer requestTimer;
+};
+
+#endif // SEARCHCOORDINATOR_H
@@ -0,0 +1,182 @@
+#include "searchthread.h"
+#include "clipdatabase.h"
+#include "logger.h"
+#include "tracer.h"
+
+#include <QMutexLocker>
+#include <QElapsedTimer>
+
+SearchRequest::SearchRequest(ClipDatabase *db) :
+    generation(0),
+    clips_flag(false),
+    params(),
+    tags_flag(false),
+    tagSearch(),
+    stringPool(*db->getStringPool()),
+    clipStore(*db->getClipStore(), &stringPool, true),
+    tagGroups()
+{
+    TagManager *tagManager = db->getTagManager();
+    tagGroups.reserve(tagManager->groups.count());
+    for (int i = 0; i < tagManager->groups.count(); i++) {
+        TagGroupSnapshot nGroup;
+        nGroup.nameId   = tagManager->groups.at(i)->getNameId();
+        nGroup.tags     = tagManager->groups.at(i)->getTagIds();
+        tagGroups.append(nGroup);
+    }
+}
+
+SearchThread::SearchThread(logger::Logger *nLog, QObject *parent) : QThread(parent),
+    log(nLog),
+    mutex(),
+    queued(),
+    pending(NULL),
+    finished(NULL),
+    busy_flag(false),
+    stop_flag(false),
+    cancel(0),
+    lastClips()
+{
+
+}
+
+SearchThread::~SearchThread() {
+    stop();
+    wait();
+    delete pending;
+    delete finished;
+}
+
+void SearchThread::enqueue(SearchRequest *nRequest) {
+    QMutexLocker locker(&mutex);
+
+    delete pending;
+    pending = nRequest;
+
+    if (busy_flag) {
+        cancel.store(1);
+    }
+
+    queued.wakeOne();
+}
+
+// Newest finished search, or NULL. The caller owns it.
+SearchResult *SearchThread::takeResult() {
+    QMutexLocker locker(&mutex);
+
+    SearchResult *rResult = finished;
+    finished = NULL;
+    return rResult;
+}
+
+// Drops anything queued and cancels the running search.
+void SearchThread::stop() {
+    QMutexLocker locker(&mutex);
+
+    stop_flag = true;
+    cancel.store(1);
+    queued.wakeOne();
+}
+
+void SearchThread::run() {
+    bool running_flag = true;
+
+    while (running_flag) {
+        SearchRequest *cRequest = NULL;
+
+        mutex.lock();
+        while (pending == NULL && !stop_flag) {
+            queued.wait(&mutex);
+        }
+
+        if (!stop_flag) {
+            cRequest = pending;
+            pending = NULL;
+            busy_flag = true;
+            cancel.store(0);
+        }
+        else {
+            running_flag = false;
+        }
+        mutex.unlock();
+
+        if (cRequest != NULL) {
+            SearchResult *nResult = new SearchResult;
+            bool finished_flag = search(*cRequest, *nResult);
+            delete cRequest;
+
+            mutex.lock();
+            busy_flag = false;
+            if (finished_flag && pending == NULL) {
+                delete finished;
+                finished = nResult;
+                nResult = NULL;
+            }
+            mutex.unlock();
+
+            if (nResult == NULL) {
+                emit resultReady();
+            }
+            delete nResult;
+        }
+    }
+}
+
+// Returns false if a newer request cancelled the search.
+bool SearchThread::search(const SearchRequest &nRequest, SearchResult &rResult) {
+    logger::TraceSpan span("SearchThread.search");
+    bool rFinished_flag = true;
+    QElapsedTimer timer;
+    timer.start();
+
+    rResult.generation = nRequest.generation;
+    rResult.clips_flag = nRequest.clips_flag;
+    rResult.tags_flag = nRequest.tags_flag;
+
+    if (nRequest.clips_flag) {
+        rFinished_flag = lastClips.update(&nRequest.clipStore, nRequest.params, &cancel);
+        rResult.clips = lastClips;
+    }
+
+    if (rFinished_flag && nRequest.tags_flag) {
+        rFinished_flag = searchTags(nRequest, rResult.tags);
+    }
+
+    if (rFinished_flag) {
+        log->trace("SearchThread.search: Search %1 took %2 ms (%3)", nRequest.generation, timer.elapsed(), lastClips.plan);
+    }
+    else {
+        log->trace("SearchThread.search: Search %1 cancelled after %2 ms", nRequest.generation, timer.elapsed());
+    }
+
+    return rFinished_flag;
+}
+
+bool SearchThread::searchTags(const SearchRequest &nRequest, TagSearchResult &rResult) {
+    const QString &cSearch = nRequest.tagSearch;
+
+    rResult.search = cSearch;
+    rResult.groups = nRequest.tagGroups;
+    rResult.visibleGroups.resize(nRequest.tagGroups.count());
+    rResult.visibleTags.resize(nRequest.tagGroups.count());
+
+    for (int i = 0; i < nRequest.tagGroups.count() && cancel.load() == 0; i++) {
+        const TagGroupSnapshot &cGroup = nRequest.tagGroups.at(i);
+        QBitArray &cVisible = rResult.visibleTags[i];
+        cVisible.resize(cGroup.tags.count());
+
+        bool addAllTags_flag = cSearch.isEmpty() || nRequest.stringPool.string(cGroup.nameId).contains(cSearch, Qt::CaseInsensitive);
+        bool addGroup_flag = addAllTags_flag;
+
+        for (int j = 0; j < cGroup.tags.count(); j++) {
+            if (addAllTags_flag || nRequest.stringPool.string(cGroup.tags.at(j)).contains(cSearch, Qt::CaseInsensitive)) {
+                cVisible.setBit(j);
+                addGroup_flag = true;
+            }
+        }
+
+        rResult.visibleGroups.setBit(i, addGroup_flag);
+    }
+
+    return cancel.load() == 0;
+}
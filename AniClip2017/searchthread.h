@@ -0,0 +1,102 @@
+#ifndef SEARCHTHREAD_H
+#define SEARCHTHREAD_H
+
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QAtomicInt>
+#include <QBitArray>
+#include <QString>
+#include <QVector>
+
+#include "stringpool.h"
+#include "clipstore.h"
+#include "clipquery.h"
+#include "modelsnapshot.h"
+
+namespace logger {
+class Logger;
+}
+
+class ClipDatabase;
+
+// One search for the worker: what to look for plus a read only copy of the
+// clip store, its indexes and the tag groups. Like ModelSnapshot every copy
+// is implicitly shared with the live model.
+class SearchRequest
+{
+public:
+    explicit SearchRequest(ClipDatabase *db);
+
+    int generation;
+
+    bool clips_flag;
+    ClipQueryParams params;
+
+    bool tags_flag;
+    QString tagSearch;
+
+    StringPool stringPool;
+    ClipStore clipStore;
+    QVector<TagGroupSnapshot> tagGroups;
+
+private:
+    Q_DISABLE_COPY(SearchRequest)
+};
+
+// Tag tree visibility for one search, in the group and tag order of groups.
+struct TagSearchResult {
+    QString                     search;
+    QVector<TagGroupSnapshot>   groups;
+    QBitArray                   visibleGroups;
+    QVector<QBitArray>          visibleTags;
+};
+
+struct SearchResult {
+    int             generation;
+    bool            clips_flag;
+    ClipQueryResult clips;
+    bool            tags_flag;
+    TagSearchResult tags;
+};
+
+// Runs searches off the GUI thread. A request that arrives while another is
+// queued replaces it, and one that arrives while a search runs cancels that
+// search; only the newest result is kept for takeResult.
+class SearchThread : public QThread
+{
+    Q_OBJECT
+public:
+    explicit SearchThread(logger::Logger *nLog, QObject *parent = 0);
+    ~SearchThread();
+
+    void enqueue(SearchRequest *nRequest);
+    SearchResult *takeResult();
+    void stop();
+
+signals:
+    void resultReady();
+
+protected:
+    void run();
+
+private:
+    bool search(const SearchRequest &nRequest, SearchResult &rResult);
+    bool searchTags(const SearchRequest &nRequest, TagSearchResult &rResult);
+
+    logger::Logger *log;
+
+    QMutex mutex;
+    QWaitCondition queued;
+
+    SearchRequest *pending;
+    SearchResult *finished;
+    bool busy_flag;
+    bool stop_flag;
+    QAtomicInt cancel;
+
+    // Only touched by the worker.
+    ClipQueryResult lastClips;
+};
+
+#endif // SEARCHTHREAD_H
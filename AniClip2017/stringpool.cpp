@@ -0,0 +1,100 @@
+#include "stringpool.h"
+#include "naturalsort.h"
+
+StringPool::StringPool() :
+    pool(),
+    ids(),
+    sortKeys()
+{
+
+}
+
+int StringPool::intern(const QString &nString) {
+    int rId = -1;
+    QHash<QString, int>::const_iterator found = ids.constFind(nString);
+
+    if (found != ids.constEnd()) {
+        rId = found.value();
+    }
+    else {
+        rId = pool.count();
+        pool.append(nString);
+        ids.insert(nString, rId);
+    }
+
+    return rId;
+}
+
+QVector<int> StringPool::intern(const QStringList &nStrings) {
+    QVector<int> rIds;
+    rIds.reserve(nStrings.count());
+
+    for (int i = 0; i < nStrings.count(); i++) {
+        rIds.append(intern(nStrings.at(i)));
+    }
+
+    return rIds;
+}
+
+int StringPool::find(const QString &nString) const {
+    return ids.value(nString, -1);
+}
+
+bool StringPool::contains(const QString &nString) const {
+    return ids.contains(nString);
+}
+
+QString StringPool::string(int nId) const {
+    QString rString;
+    if (nId >= 0 && nId < pool.count()) {
+        rString = pool.at(nId);
+    }
+    return rString;
+}
+
+QStringList StringPool::strings(const QVector<int> &nIds) const {
+    QStringList rStrings;
+    rStrings.reserve(nIds.count());
+
+    for (int i = 0; i < nIds.count(); i++) {
+        rStrings.append(string(nIds.at(i)));
+    }
+
+    return rStrings;
+}
+
+const QByteArray &StringPool::sortKey(int nId) {
+    if (sortKeys.count() < pool.count()) {
+        sortKeys.resize(pool.count());
+    }
+
+    QByteArray &rKey = sortKeys[nId];
+    if (rKey.isEmpty() && !pool.at(nId).isEmpty()) {
+        rKey = naturalSortKey(pool.at(nId));
+    }
+
+    return rKey;
+}
+
+int StringPool::count() const {
+    return pool.count();
+}
+
+qint64 StringPool::memoryUsage() const {
+    qint64 rBytes = pool.capacity() * sizeof(QString);
+
+    for (int i = 0; i < pool.count(); i++) {
+        rBytes += pool.at(i).capacity() * sizeof(QChar);
+    }
+
+    // QHash node: next pointer, hash, key and value.
+    rBytes += ids.count() * (sizeof(void*) + sizeof(uint) + sizeof(QString) + sizeof(int));
+    rBytes += ids.capacity() * sizeof(void*);
+
+    rBytes += sortKeys.capacity() * sizeof(QByteArray);
+    for (int i = 0; i < sortKeys.count(); i++) {
+        rBytes += sortKeys.at(i).capacity();
+    }
+
+    return rBytes;
+}
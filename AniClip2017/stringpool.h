@@ -0,0 +1,40 @@
+#ifndef STRINGPOOL_H
+#define STRINGPOOL_H
+
+#include <QString>
+#include <QByteArray>
+#include <QStringList>
+#include <QVector>
+#include <QHash>
+
+// Interning table for show names, tags, seasons and list names. Every distinct
+// string is stored once and handed out as a small integer id, so the data
+// model can compare ids instead of strings. Ids are never reused.
+class StringPool
+{
+public:
+    StringPool();
+
+    int intern(const QString &nString);
+    QVector<int> intern(const QStringList &nStrings);
+
+    int find(const QString &nString) const;
+    bool contains(const QString &nString) const;
+
+    QString string(int nId) const;
+    QStringList strings(const QVector<int> &nIds) const;
+
+    const QByteArray &sortKey(int nId);
+
+    int count() const;
+    qint64 memoryUsage() const;
+
+private:
+    QVector<QString>    pool;
+    QHash<QString, int> ids;
+
+    // Natural sort keys, filled in the first time an id is sorted.
+    QVector<QByteArray> sortKeys;
+};
+
+#endif // STRINGPOOL_H
@@ -1,6 +1,9 @@
 #include "tagtreewidget.h"
 
 #include "logger.h"
+#include "rowdiff.h"
+#include "searchthread.h"
+#include "tracer.h"
 
 #include <QTreeWidgetItem>
 
@@ -10,7 +13,9 @@
 
 TagTreeWidget::TagTreeWidget(QWidget *parent) : QTreeWidget(parent),
     clipDB(NULL),
-    log(NULL)
+    log(NULL),
+    groupItems(),
+    lastSearch()
 {
     setColumnCount(1);
 
@@ -27,98 +32,194 @@ void TagTreeWidget::setLogger(logger::Logger *nLog) {
     log = nLog;
 }
 
+// Items are only created or deleted where the tag groups changed, so an
+// update while typing a search just toggles visibility. If nothing changed and
+// the search only got longer, hidden items cannot come back and are skipped.
 void TagTreeWidget::updateTags(const QString &searchString) {
+    logger::TraceSpan span("TagTreeWidget.updateTags");
     QElapsedTimer nTimer;
     nTimer.start();
     TagManager *tagMan = clipDB->getTagManager();
+    StringPool *pool = clipDB->getStringPool();
 
-    //qSort(tagMan->groups.begin(), tagMan->groups.end(), compareGroups);
+    bool changed_flag = syncGroups(tagMan);
+    bool narrow_flag = !changed_flag && searchString.contains(lastSearch, Qt::CaseInsensitive);
 
-    int numGroupsAdded = 0;
-    bool addGroup_flag = false;
-    bool addAllTags_flag = false;
+    for (int i = 0; i < groupItems.count(); i++) {
+        GroupItems &cGroup = groupItems[i];
+        QTreeWidgetItem *nItem = cGroup.item;
 
+        if (!narrow_flag || !nItem->isHidden()) {
+            QString cName = pool->string(cGroup.nameId);
+            bool addAllTags_flag = searchString.isEmpty() || cName.contains(searchString, Qt::CaseInsensitive);
+            bool addGroup_flag = addAllTags_flag;
+            int numTags = 0;
 
+            for (int j = 0; j < cGroup.tags.count(); j++) {
+                QTreeWidgetItem *nChild = nItem->child(j);
 
-    for (int i = 0; i < tagMan->groups.count(); i++) {
-        int numTopItems = topLevelItemCount();
-        QTreeWidgetItem* nItem = NULL;
-        if (i >= numTopItems) {
-            nItem = new QTreeWidgetItem(this);
-            addTopLevelItem(nItem);
-        }
-        else{
-            nItem = topLevelItem(i);
-        }
+                if (!narrow_flag || !nChild->isHidden()) {
+                    bool show_flag = addAllTags_flag || pool->string(cGroup.tags.at(j)).contains(searchString, Qt::CaseInsensitive);
+                    setItemHidden(nChild, !show_flag);
+                }
+
+                if (!nChild->isHidden()) {
+                    addGroup_flag = true;
+                    numTags++;
+                }
+            }
 
-        addGroup_flag = false;
-        addAllTags_flag = false;
-        if (searchString.isEmpty()) {
-            addGroup_flag = true;
-            addAllTags_flag = true;
+            setItemHidden(nItem, !addGroup_flag);
+            setGroupCount(cGroup, numTags);
         }
+    }
 
-        if (nItem != NULL) {
-            TagGroup *cGroup = tagMan->groups.at(i);
-            QString cName = cGroup->getName();
-            QStringList cTags = cGroup->getTags();
-            int numTags = 0;
+    lastSearch = searchString;
+
+    if (log != NULL) {
+        log->trace("TagTreeWidget.updateTags: %1 groups in %2 ms", groupItems.count(), nTimer.elapsed());
+    }
+}
+
+// Applies a search SearchThread ran. If the tag groups changed since its copy
+// was taken the result no longer lines up, so the search is redone here.
+void TagTreeWidget::showResult(const TagSearchResult &nResult) {
+    logger::TraceSpan span("TagTreeWidget.showResult");
+    bool current_flag = !syncGroups(clipDB->getTagManager()) && groupItems.count() == nResult.groups.count();
 
-            if (cName.contains(searchString, Qt::CaseInsensitive)) {
-                addGroup_flag = true;
-                addAllTags_flag = true;
+    for (int i = 0; i < groupItems.count() && current_flag; i++) {
+        current_flag = groupItems.at(i).nameId == nResult.groups.at(i).nameId &&
+                       groupItems.at(i).tags   == nResult.groups.at(i).tags;
+    }
+
+    if (current_flag) {
+        for (int i = 0; i < groupItems.count(); i++) {
+            GroupItems &cGroup = groupItems[i];
+            const QBitArray &cVisible = nResult.visibleTags.at(i);
+
+            for (int j = 0; j < cGroup.tags.count(); j++) {
+                setItemHidden(cGroup.item->child(j), !cVisible.testBit(j));
             }
 
-            //qSort(cTags.begin(), cTags.end(), compareTags);
+            setItemHidden(cGroup.item, !nResult.visibleGroups.testBit(i));
+            setGroupCount(cGroup, cVisible.count(true));
+        }
 
-            for (int j = 0; j < cTags.count(); j++) {
-                QTreeWidgetItem *nChild = NULL;
-                int numItems = nItem->childCount();
+        lastSearch = nResult.search;
+    }
+    else {
+        updateTags(nResult.search);
+    }
+}
 
-                if (addAllTags_flag || cTags.at(j).contains(searchString, Qt::CaseInsensitive)) {
+void TagTreeWidget::setGroupCount(GroupItems &rGroup, int nNumTags) {
+    QString groupName = QString("%1 (%2 tags)").arg(clipDB->getStringPool()->string(rGroup.nameId)).arg(nNumTags);
+    if (rGroup.item->text(0) != groupName) {
+        rGroup.item->setText(0, groupName);
+    }
+}
 
-                    if (j >= numItems) {
-                        nChild = new QTreeWidgetItem();
-                        nItem->addChild(nChild);
-                    }
-                    else {
-                        nChild = nItem->child(numTags);
-                    }
+// Brings the top level items in line with the tag groups. Returns true if any
+// item was added, removed or moved.
+bool TagTreeWidget::syncGroups(TagManager *nTagMan) {
+    bool rChanged_flag = false;
+
+    QVector<int> oldKeys;
+    QVector<int> newKeys;
+    oldKeys.reserve(groupItems.count());
+    newKeys.reserve(nTagMan->groups.count());
+    for (int i = 0; i < groupItems.count(); i++) {
+        oldKeys.append(groupItems.at(i).nameId);
+    }
+    for (int i = 0; i < nTagMan->groups.count(); i++) {
+        newKeys.append(nTagMan->groups.at(i)->getNameId());
+    }
 
-                    if (nChild != NULL) {
-                        nChild->setText(0, cTags.at(j));
-                        nChild->setHidden(false);
-                        addGroup_flag = true;
-                        numTags++;
+    RowDiff diff = diffRows(oldKeys, newKeys);
 
-                    }
-                    else {
-                        log->err(QString("Unable to create child for TagGroup %1").arg(cName));
-                    }
-                }
-            }
+    if (diff.reordered_flag) {
+        // Surviving groups moved, so start over.
+        clear();
+        groupItems.clear();
+        diff.removed.clear();
+        diff.inserted.clear();
 
-            if (addGroup_flag) {
-                nItem->setHidden(false);
-                if (numTags < nItem->childCount()) {
-                    for (int t = numTags; t < nItem->childCount(); t++) {
-                        nItem->child(t)->setHidden(true);
-                    }
-                }
+        RowRange nRange;
+        nRange.first = 0;
+        nRange.last = newKeys.count() - 1;
+        if (nRange.last >= 0) {
+            diff.inserted.append(nRange);
+        }
+    }
 
-            }
-            else {
-                nItem->setHidden(true);
-            }
+    for (int i = 0; i < diff.removed.count(); i++) {
+        for (int row = diff.removed.at(i).last; row >= diff.removed.at(i).first; row--) {
+            delete takeTopLevelItem(row);
+            groupItems.remove(row);
+        }
+    }
 
-            QString groupName = QString("%1 (%2 tags)").arg(cName).arg(numTags);
-            nItem->setText(0, groupName);
+    for (int i = 0; i < diff.inserted.count(); i++) {
+        for (int row = diff.inserted.at(i).first; row <= diff.inserted.at(i).last; row++) {
+            GroupItems nGroup;
+            nGroup.nameId = newKeys.at(row);
+            nGroup.item = new QTreeWidgetItem();
+            insertTopLevelItem(row, nGroup.item);
+            groupItems.insert(row, nGroup);
         }
-        else {
-            log->err(QString("Unable to create new Top Level TagTreeItem."));
+    }
+
+    rChanged_flag = !diff.isEmpty();
+
+    for (int i = 0; i < groupItems.count(); i++) {
+        if (syncTags(groupItems[i], nTagMan->groups.at(i)->getTagIds())) {
+            rChanged_flag = true;
         }
     }
 
-    //log->info(QString("TagUpdate took %1 seconds").arg(nTimer.elapsed()/1000.0,4,'f',2));
+    return rChanged_flag;
+}
 
+bool TagTreeWidget::syncTags(GroupItems &rGroup, const QVector<int> &nTags) {
+    RowDiff diff = diffRows(rGroup.tags, nTags);
+    StringPool *pool = clipDB->getStringPool();
+
+    if (diff.reordered_flag) {
+        qDeleteAll(rGroup.item->takeChildren());
+        rGroup.tags.clear();
+        diff.removed.clear();
+        diff.inserted.clear();
+
+        RowRange nRange;
+        nRange.first = 0;
+        nRange.last = nTags.count() - 1;
+        if (nRange.last >= 0) {
+            diff.inserted.append(nRange);
+        }
+    }
+
+    for (int i = 0; i < diff.removed.count(); i++) {
+        for (int row = diff.removed.at(i).last; row >= diff.removed.at(i).first; row--) {
+            delete rGroup.item->takeChild(row);
+        }
+    }
+
+    for (int i = 0; i < diff.inserted.count(); i++) {
+        for (int row = diff.inserted.at(i).first; row <= diff.inserted.at(i).last; row++) {
+            QTreeWidgetItem *nChild = new QTreeWidgetItem();
+            nChild->setText(0, pool->string(nTags.at(row)));
+            rGroup.item->insertChild(row, nChild);
+        }
+    }
+
+    rGroup.tags = nTags;
+
+    return !diff.isEmpty();
+}
+
+// setHidden relayouts the view even if nothing changes.
+void TagTreeWidget::setItemHidden(QTreeWidgetItem *nItem, bool nHidden) {
+    if (nItem->isHidden() != nHidden) {
+        nItem->setHidden(nHidden);
+    }
 }
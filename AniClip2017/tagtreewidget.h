@@ -6,6 +6,8 @@
 
 #include "clipdatabase.h"
 
+struct TagSearchResult;
+
 namespace logger {
 class Logger;
 }
@@ -20,18 +22,28 @@ public:
     void setLogger(logger::Logger *nLog);
 
 private:
+    // Tags shown under one top level item, in row order.
+    struct GroupItems {
+        int                 nameId;
+        QVector<int>        tags;
+        QTreeWidgetItem     *item;
+    };
+
+    bool syncGroups(TagManager *nTagMan);
+    bool syncTags(GroupItems &rGroup, const QVector<int> &nTags);
+    void setGroupCount(GroupItems &rGroup, int nNumTags);
+    static void setItemHidden(QTreeWidgetItem *nItem, bool nHidden);
+
     ClipDatabase *clipDB;
     logger::Logger *log;
 
-    QVector <QTreeWidgetItem*> old_top;
-    QVector <QTreeWidgetItem*> old_items;
-
-    int nTopCount;
-    int nItemCount;
+    QVector<GroupItems> groupItems;
+    QString lastSearch;
 signals:
 
 public slots:
     void updateTags(const QString &searchString);
+    void showResult(const TagSearchResult &nResult);
 };
 
 #endif // TAGTREEWIDGET_H
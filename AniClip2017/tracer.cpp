@@ -0,0 +1,177 @@
+#include "tracer.h"
+#include "perfstats.h"
+
+#include <QAtomicInt>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QThread>
+#include <QTextStream>
+#include <QVector>
+
+using namespace logger;
+
+namespace {
+
+struct TraceEvent {
+    const char  *name;
+    qint64      startNsecs;
+    qint64      endNsecs;
+};
+
+// Events of one thread. Only its thread appends; the lock is there for
+// exports, so it is never contended while recording.
+struct TraceBuffer {
+    int                 tid;
+    QString             threadName;
+    QMutex              mutex;
+    QVector<TraceEvent> events;
+    int                 numDropped;
+};
+
+const int maxEvents = 200000;
+
+QAtomicInt enabled(0);
+
+QElapsedTimer startedClock() {
+    QElapsedTimer rClock;
+    rClock.start();
+    return rClock;
+}
+
+// Buffers outlive their threads so an export still sees them.
+QMutex buffersMutex;
+QVector<TraceBuffer*> buffers;
+thread_local TraceBuffer *localBuffer = NULL;
+
+TraceBuffer *threadBuffer() {
+    if (localBuffer == NULL) {
+        TraceBuffer *nBuffer = new TraceBuffer;
+        nBuffer->numDropped = 0;
+
+        QThread *cThread = QThread::currentThread();
+        nBuffer->threadName = cThread->objectName();
+        if (nBuffer->threadName.isEmpty()) {
+            nBuffer->threadName = cThread->metaObject()->className();
+        }
+
+        QMutexLocker locker(&buffersMutex);
+        nBuffer->tid = buffers.count() + 1;
+        buffers.append(nBuffer);
+
+        localBuffer = nBuffer;
+    }
+
+    return localBuffer;
+}
+
+QString jsonString(const QString &nText) {
+    QString rText = nText;
+    rText.replace('\\', "\\\\").replace('"', "\\\"");
+    return "\"" + rText + "\"";
+}
+
+}
+
+TraceSpan::TraceSpan(const char *nName) :
+    name(nName),
+    startNsecs(Tracer::now())
+{
+
+}
+
+TraceSpan::~TraceSpan() {
+    qint64 endNsecs = Tracer::now();
+
+    if (Tracer::isEnabled()) {
+        Tracer::record(name, startNsecs, endNsecs);
+    }
+    PerfStats::add(name, endNsecs - startNsecs);
+}
+
+void Tracer::setEnabled(bool nEnabled) {
+    enabled.store(nEnabled ? 1 : 0);
+}
+
+bool Tracer::isEnabled() {
+    return enabled.load() != 0;
+}
+
+// Nanoseconds since the first span of the process.
+qint64 Tracer::now() {
+    static QElapsedTimer traceClock = startedClock();
+    return traceClock.nsecsElapsed();
+}
+
+void Tracer::record(const char *nName, qint64 nStartNsecs, qint64 nEndNsecs) {
+    TraceBuffer *cBuffer = threadBuffer();
+    QMutexLocker locker(&cBuffer->mutex);
+
+    if (cBuffer->events.count() < maxEvents) {
+        TraceEvent nEvent;
+        nEvent.name = nName;
+        nEvent.startNsecs = nStartNsecs;
+        nEvent.endNsecs = nEndNsecs;
+        cBuffer->events.append(nEvent);
+    }
+    else {
+        cBuffer->numDropped++;
+    }
+}
+
+void Tracer::clear() {
+    QMutexLocker locker(&buffersMutex);
+
+    for (int i = 0; i < buffers.count(); i++) {
+        QMutexLocker bufferLocker(&buffers.at(i)->mutex);
+        buffers.at(i)->events.clear();
+        buffers.at(i)->numDropped = 0;
+    }
+}
+
+// Writes every recorded span as a complete ("X") event in the Chrome trace
+// event format, which chrome://tracing and Perfetto open directly.
+bool Tracer::exportChromeTrace(const QString &nFilename) {
+    bool rSuccess_flag = false;
+    QFile traceFile(nFilename);
+
+    if (traceFile.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text)) {
+        QTextStream out(&traceFile);
+        out.setCodec("UTF-8");
+        out << "{\"traceEvents\":[" << endl;
+
+        bool first_flag = true;
+        QMutexLocker locker(&buffersMutex);
+
+        for (int i = 0; i < buffers.count(); i++) {
+            TraceBuffer *cBuffer = buffers.at(i);
+            QMutexLocker bufferLocker(&cBuffer->mutex);
+
+            out << (first_flag ? "" : ",\n")
+                << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << cBuffer->tid
+                << ",\"args\":{\"name\":" << jsonString(cBuffer->threadName) << "}}";
+            first_flag = false;
+
+            for (int j = 0; j < cBuffer->events.count(); j++) {
+                const TraceEvent &cEvent = cBuffer->events.at(j);
+                out << ",\n{\"name\":" << jsonString(QString::fromUtf8(cEvent.name))
+                    << ",\"cat\":\"aniclip\",\"ph\":\"X\",\"pid\":1,\"tid\":" << cBuffer->tid
+                    << ",\"ts\":" << QString::number(cEvent.startNsecs / 1000.0, 'f', 3)
+                    << ",\"dur\":" << QString::number((cEvent.endNsecs - cEvent.startNsecs) / 1000.0, 'f', 3) << "}";
+            }
+
+            if (cBuffer->numDropped > 0) {
+                out << ",\n{\"name\":\"dropped spans\",\"ph\":\"C\",\"pid\":1,\"tid\":" << cBuffer->tid
+                    << ",\"ts\":0,\"args\":{\"count\":" << cBuffer->numDropped << "}}";
+            }
+        }
+
+        out << endl << "]}" << endl;
+        out.flush();
+        rSuccess_flag = traceFile.error() == QFile::NoError;
+        traceFile.close();
+    }
+
+    return rSuccess_flag;
+}
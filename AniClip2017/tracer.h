@@ -0,0 +1,48 @@
+#ifndef TRACER_H
+#define TRACER_H
+
+#include <QString>
+
+namespace logger {
+
+// Timed section of code. Construct one at the top of a scope; on
+// destruction its duration goes to PerfStats and, when tracing is on, into a
+// buffer owned by the calling thread. Both are per thread, so spans never
+// contend; with tracing off a span costs a few clock reads and one hash
+// lookup, with no allocation. nName must be a string literal. Spans belong
+// around whole operations, not per item work.
+class TraceSpan
+{
+public:
+    explicit TraceSpan(const char *nName);
+    ~TraceSpan();
+
+private:
+    Q_DISABLE_COPY(TraceSpan)
+
+    const char *name;
+    qint64 startNsecs;
+};
+
+// Switch and export for TraceSpan. Each thread records into its own buffer,
+// so spans on different threads never contend; a buffer that fills up stops
+// recording and counts what it dropped.
+class Tracer
+{
+public:
+    static void setEnabled(bool nEnabled);
+    static bool isEnabled();
+
+    static bool exportChromeTrace(const QString &nFilename);
+    static void clear();
+
+private:
+    friend class TraceSpan;
+
+    static qint64 now();
+    static void record(const char *nName, qint64 nStartNsecs, qint64 nEndNsecs);
+};
+
+}
+
+#endif // TRACER_H
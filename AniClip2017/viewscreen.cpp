@@ -4,6 +4,7 @@
 #include "clipdatabase.h"
 #include "logger.h"
 #include "tagtreewidget.h"
+#include "searchcoordinator.h"
 
 #include <QDebug>
 
@@ -11,7 +12,8 @@ ViewScreen::ViewScreen(logger::Logger *nLog, QWidget *parent) :
     QWidget(parent),
     ui(new Ui::ViewScreen),
     log(nLog),
-    clipDb(NULL)
+    clipDb(NULL),
+    search(NULL)
 {
     ui->setupUi(this);
 
@@ -34,6 +36,11 @@ bool ViewScreen::init(QString config_filename, ClipDatabase *nDb) {
         ui->clipTreeWidget->setClipDatabase(clipDb);
         ui->clipTreeWidget->setLogger(log);
         ui->clipTreeWidget->clearSearchParams();
+
+        search = new SearchCoordinator(log, this);
+        search->setClipDatabase(clipDb);
+        search->setClipTree(ui->clipTreeWidget);
+        search->setTagTree(ui->tagTreeWidget);
         QList<int> nSizes;
         nSizes << ui->centralTab->minimumSizeHint().height() << ui->clipTreeWidget->maximumSize().height();
         qDebug() << nSizes;
@@ -50,10 +57,17 @@ bool ViewScreen::init(QString config_filename, ClipDatabase *nDb) {
 
 void ViewScreen::updateInfo() {
     ui->tagTreeWidget->updateTags("");
-    ui->clipTreeWidget->updateClips("");
+
+    if (search != NULL) {
+        search->searchClips();
+        search->searchNow();
+    }
 }
 
+// Searching runs on SearchCoordinator's worker once typing pauses.
 void ViewScreen::on_lineEdit_10_textChanged(const QString &arg1)
 {
-    ui->tagTreeWidget->updateTags(arg1);
+    if (search != NULL) {
+        search->searchTags(arg1);
+    }
 }
@@ -8,6 +8,7 @@ class Logger;
 }
 
 class ClipDatabase;
+class SearchCoordinator;
 
 namespace Ui {
 class ViewScreen;
@@ -33,6 +34,7 @@ private:
 
     logger::Logger *log;
     ClipDatabase *clipDb;
+    SearchCoordinator *search;
 };
 
 #endif // VIEWSCREEN_H